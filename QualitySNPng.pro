@@ -9,6 +9,14 @@ QT       += core gui
 TARGET = QualitySNPng
 TEMPLATE = app
 
+LIBS += -lz
+
+# reading zstd compressed input needs libzstd: qmake CONFIG+=zstd
+zstd {
+    DEFINES += QSNP_HAVE_ZSTD
+    LIBS += -lzstd
+}
+
 
 SOURCES += main.cpp\
     core/trunk/Variation.cpp \
@@ -34,7 +42,21 @@ SOURCES += main.cpp\
     alignmentpicture.cpp \
     contiglistmodel.cpp \
     readgroupmodel.cpp \
-    core/trunk/ReadGroup.cpp
+    core/trunk/ReadGroup.cpp \
+    core/trunk/BGZFFile.cpp \
+    core/trunk/BAMFile.cpp \
+    core/trunk/InputFile.cpp \
+    core/trunk/LineReader.cpp \
+    core/trunk/ContigIndex.cpp \
+    core/trunk/RegionList.cpp \
+    core/trunk/CompressedFile.cpp \
+    core/trunk/ContigGrouper.cpp \
+    core/trunk/Pileup.cpp \
+    core/trunk/ReferenceFile.cpp \
+    core/trunk/ContigArena.cpp \
+    core/trunk/ReadIntervalIndex.cpp \
+    core/trunk/RunParameters.cpp \
+    core/trunk/ReadAlleles.cpp
 
 HEADERS  += \
     core/trunk/Variation.h \
@@ -62,7 +84,21 @@ HEADERS  += \
     alignmentpicture.h \
     contiglistmodel.h \
     readgroupmodel.h \
-    core/trunk/ReadGroup.h
+    core/trunk/ReadGroup.h \
+    core/trunk/BGZFFile.h \
+    core/trunk/BAMFile.h \
+    core/trunk/InputFile.h \
+    core/trunk/LineReader.h \
+    core/trunk/ContigIndex.h \
+    core/trunk/RegionList.h \
+    core/trunk/CompressedFile.h \
+    core/trunk/ContigGrouper.h \
+    core/trunk/Pileup.h \
+    core/trunk/ReferenceFile.h \
+    core/trunk/ContigArena.h \
+    core/trunk/ReadIntervalIndex.h \
+    core/trunk/RunParameters.h \
+    core/trunk/ReadAlleles.h
 
 FORMS    += \
     rundialog.ui \
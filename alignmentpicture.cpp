@@ -380,6 +380,7 @@ void AlignmentPicture::loadSequences() {
     _coverage.resize(_pContig->getSequenceLength());
     _readInfo.clear();
     _readInfo.reserve(_cRows);
+    _readRows.clear();
     for(list<SeqRead*>::const_iterator itReads = _reads.begin(); itReads != _reads.end(); itReads++) {
         string sequence =  (*itReads)->getSequence();
         int startPos =  (*itReads)->getStartPosition();
@@ -403,6 +404,7 @@ void AlignmentPicture::loadSequences() {
         readInfo.sequence = qsequence;
         HaploType* pHap = (*itReads)->getHaploType();
         readInfo.haplotypeID = (pHap != NULL) ? pHap->getID() : -1;
+        _readRows[*itReads] = _readInfo.size();
         _readInfo.push_back(readInfo);
     }
 
@@ -627,9 +629,19 @@ void AlignmentPicture::showOverview()
 
 void AlignmentPicture::scrollToPosition(int pos)
 {
-    int iRow = 0;
-    while(iRow < _cRows && _readInfo[iRow].end < pos) {
-        iRow++;
+    // the top row of the reads at the position, or the first row that ends
+    // after it when no read covers the position
+    vector<SeqRead*> reads = _pContig->readsOverlapping(pos);
+    int iRow = _cRows;
+    for(vector<SeqRead*>::iterator itReads = reads.begin(); itReads != reads.end(); itReads++) {
+        iRow = qMin(iRow, _readRows.value(*itReads, _cRows));
+    }
+
+    if(reads.empty()) {
+        iRow = 0;
+        while(iRow < _cRows && _readInfo[iRow].end < pos) {
+            iRow++;
+        }
     }
 
     _y = 0;
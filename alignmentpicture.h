@@ -65,6 +65,7 @@ private:
     list<SeqRead*>      _reads;
     Contig*             _pContig;
     QVector<ReadInfo>   _readInfo;
+    QMap<SeqRead*, int> _readRows;
     QVector<int>        _coverage;
     QVector<int>        _coverageNorm;
     QPixmap*            _pict;
@@ -19,29 +19,48 @@
 */
 
 #include <iostream>
-#include <sstream>
+#include <algorithm>
+#include <string.h>
+#include <QThread>
 #include "SeqRead.h"
 #include "Contig.h"
+#include "LineReader.h"
 #include "ACEFile.h"
 
 using namespace std;
 
-ACEFile::ACEFile(const string& contigFilename): _contigFilename(contigFilename), _pContig(NULL),
-  _cReads(-1), _cContigs(-1)
+// size of the contig blocks handed to a parser thread at once
+static const uint64_t ACE_BATCH_SIZE = 1 << 22;
+
+// number of batches each parser thread may work ahead of the reader
+static const int ACE_BATCHES_AHEAD = 2;
+
+class ACEParser : public QThread
+{
+public:
+	ACEParser(ACEFile* pFile): _pFile(pFile) {}
+
+protected:
+	void run() { _pFile->runParser(); }
+
+private:
+	ACEFile* _pFile;
+};
+
+ACEFile::ACEFile(const string& contigFilename): _contigFilename(contigFilename), _lineReader(contigFilename),
+  _contigIndex(contigFilename), _cReads(-1), _cContigs(-1),
+  _cParseThreads(Configuration::getConfig()->getInt("parsingThreads")),
+  _nextBatchSequence(0), _nextTakeSequence(0), _nextBatchContig(0), _bAllBatchesClaimed(false), _bParsedEOF(false), _bStopParsers(false)
 {
 }
 
 ACEFile::~ACEFile(void)
 {
+	stopParsers();
 }
 
 bool ACEFile::openFile() {
-	if(_ifACEFile.is_open()) {
-		return true;
-	}
-
-	_ifACEFile.open(_contigFilename.c_str(),ios::in);
-	if (_ifACEFile.fail()) {
+	if(!_lineReader.openFile()) {
         Logger::getLogger()->log(QSNP_ERROR, "could not open contig file: " + _contigFilename);
 		return false;
 	}
@@ -49,26 +68,24 @@ bool ACEFile::openFile() {
 }
 
 bool ACEFile::isValid() {
-	if(!openFile()) {
+	if(!openFile() || !_lineReader.rewind()) {
 		return false;
 	}
-		
-    _ifACEFile.seekg (0, ios::beg);
 
 	int cLines = 1;
-	string line;
+	const char* line;
+	int length;
 	bool foundCO = false;
 
 	// scan 100 lines to find a CO line indicating a new contig block start
-	while(cLines < 100 && getline(_ifACEFile,line) && !foundCO) {
-		if (!emptyLine(line) && line[0] == 'C' && line[1] == 'O') {
+	while(cLines < 100 && !foundCO && _lineReader.nextLine(line, length)) {
+		if (length >= 2 && line[0] == 'C' && line[1] == 'O') {
             foundCO = true;
 		}
 		cLines++;
 	};
 
-    _ifACEFile.clear();	
-    _ifACEFile.seekg (0, ios::beg);
+    _lineReader.rewind();
     return foundCO;
 }
 
@@ -99,16 +116,30 @@ vector<string> &ACEFile::readGroups()
     return _readGroups;
 }
 
+// return the next contig in the ACE file, or NULL if there are no more contigs
+// with more than one parsing thread a memory mapped file is parsed in parallel
 Contig* ACEFile::nextContig() {
-	//char line[MAX_LINE_LENGTH];
-	string line;
+	if(!openFile()) {
+		return NULL;
+	}
+
+	if(_cParseThreads > 1 && _lineReader.isMapped()) {
+		return takeParsedContig();
+	}
+
+	return readContig(_lineReader);
+}
 
-	string contig_sequence;
-	string read_sequence;
+// the lines are taken from the mapped (or block buffered) file without copying
+// them, records are decoded in place and the sequences are reserved with the
+// lengths given in the CO and RD records
+Contig* ACEFile::readContig(LineReader& lineReader) {
+	const char* line;
+	int length;
+	int cBases = 0;
 
-	Contig* pContig = _pContig;
+	Contig* pContig = NULL;
 	SeqRead* pRead = NULL;
-	_pContig = NULL;
 
 	enum ReadState {
 		readingContig,
@@ -121,20 +152,28 @@ Contig* ACEFile::nextContig() {
 
 	// find the CO line indicating a new contig block start
 	while(pContig == NULL) {
-		if(!getline(_ifACEFile, line)) {
+		if(!lineReader.nextLine(line, length)) {
 			return NULL;
 		}
 
-		if (line[0] == 'C' && line[1] == 'O' && line[2] <= ' ') {
-			pContig = parseContigLine(line);
+		if (getBlockLabel(line, length) == CO) {
+			pContig = parseContigLine(line, length, cBases);
 		}
 	}
 
 	string data;
+	data.reserve(cBases);
+	vector<int> qualities;
+
+	// the AF records come in the same order as the RD records, so the read
+	// of an RD record is normally the next one located
+	vector<SeqRead*> locatedReads;
+	size_t iNextRead = 0;
 
 	// start parsing the contig text block
-	while(getline(_ifACEFile,line)) {
-		if(emptyLine(line)) {
+	uint64_t lineOffset = lineReader.tell();
+	for(; lineReader.nextLine(line, length); lineOffset = lineReader.tell()) {
+		if(length == 0) {
 			switch(readState) {
 				case readingContig:
 					pContig->setSequence(data);
@@ -143,177 +182,454 @@ Contig* ACEFile::nextContig() {
 					pRead->setSequence(data);
 					break;
 				case readingQuality:
-					pContig->setQuality(data);
+					pContig->setQuality(qualities);
 					break;
                 default:
                     break;
 			}
 			data.clear();
+			qualities.clear();
 			readState = lookingForBlock;
 		} else if (readState == lookingForBlock) {
 			// looking for new sub block
-			switch (getBlockLabel(line)){
+			switch (getBlockLabel(line, length)){
 				case CO:
-					// new contig found, store the new contig line
+					// new contig found, leave its CO line for the next call
 					// and return the current contig object
-					_pContig = parseContigLine(line);
+					lineReader.seek(lineOffset);
 					return pContig;
 					break;
 				case RD:
-					pRead = parseReadLine(line, pContig);
+					pRead = parseReadLine(line, length, cBases, pContig, locatedReads, iNextRead);
 					if (pRead == NULL) {
-						Logger::getLogger()->log(QSNP_ERROR, "Invalid read line" + line);
+						Logger::getLogger()->log(QSNP_ERROR, "Invalid read line" + string(line, length));
 						return NULL;
 					}
+					data.reserve(cBases);
 					readState = readingRead;
 					break;
 				case AF:
-                    pRead = parseReadLocationLine(line, pContig);
-					pContig->addRead(pRead);
+                    pRead = parseReadLocationLine(line, length, pContig);
+					if(pContig->addRead(pRead)) {
+						locatedReads.push_back(pRead);
+					}
 					break;
 				case QA:
-					parseQualitySegmentLine(line,pRead);
+					parseQualitySegmentLine(line, length, pRead);
 					break;
 				case BQ:
+					qualities.reserve(pContig->getSequence().size());
 					readState = readingQuality;
 					break;
                 default:
                     break;
 			}
+		} else if (readState == readingQuality) {
+			parseBaseQualityLine(line, length, qualities);
 		} else {
-			data += line;
+			data.append(line, length);
 		}
 	}
 
 	return pContig;
 }
 
-bool ACEFile::emptyLine(const string& line) {
-	return line.empty() || (line.size() == 1 && line[0] == '\r');
+// parse the contigs of a batch of contig blocks starting at a CO line
+void ACEFile::parseBatch(LineReader& lineReader, uint64_t start, size_t cContigs, list<Contig*>& contigs) {
+	if(!lineReader.seek(start)) {
+		Logger::getLogger()->log(QSNP_ERROR, "could not seek in contig file: " + _contigFilename);
+		return;
+	}
+
+	for(size_t iContig = 0; iContig < cContigs; iContig++) {
+		Contig* pContig = readContig(lineReader);
+		if(pContig == NULL) {
+			break;
+		}
+		contigs.push_back(pContig);
+	}
+}
+
+void ACEFile::startParsers() {
+	_bStopParsers = false;
+	for(int iThread = 0; iThread < _cParseThreads; iThread++) {
+		ACEParser* pParser = new ACEParser(this);
+		_parsers.push_back(pParser);
+		pParser->start();
+	}
 }
 
-BLOCKLABEL ACEFile::getBlockLabel(const string& line) {
-	if(line[0] == 'C' && line[1] == 'O' && line[2] <= ' ') {
+void ACEFile::stopParsers() {
+	if(_parsers.empty()) {
+		return;
+	}
+
+	_mutex.lock();
+	_bStopParsers = true;
+	_batchTaken.wakeAll();
+	_mutex.unlock();
+
+	vector<ACEParser*>::iterator itParsers;
+	for(itParsers = _parsers.begin(); itParsers != _parsers.end(); itParsers++) {
+		(*itParsers)->wait();
+		delete *itParsers;
+	}
+	_parsers.clear();
+
+	map<int64_t, list<Contig*>*>::iterator itBatches;
+	for(itBatches = _parsedBatches.begin(); itBatches != _parsedBatches.end(); itBatches++) {
+		_parsedContigs.splice(_parsedContigs.end(), *itBatches->second);
+		delete itBatches->second;
+	}
+	_parsedBatches.clear();
+
+	while(!_parsedContigs.empty()) {
+		delete _parsedContigs.front();
+		_parsedContigs.pop_front();
+	}
+}
+
+// the parser threads take turns claiming the next contig blocks of the index
+// until a batch is large enough, parse them with a reader of their own
+// without holding the lock and hand the contigs over by sequence number
+void ACEFile::runParser() {
+	int maxBatchesAhead = ACE_BATCHES_AHEAD * _cParseThreads;
+	const vector<ContigIndexEntry>& contigs = _contigIndex.getContigs();
+	LineReader lineReader(_contigFilename);
+
+	_mutex.lock();
+	while(!_bStopParsers) {
+		if(_bAllBatchesClaimed || _nextBatchSequence - _nextTakeSequence >= maxBatchesAhead) {
+			_batchTaken.wait(&_mutex);
+			continue;
+		}
+
+		int64_t sequence = _nextBatchSequence++;
+		list<Contig*>* pContigs = new list<Contig*>();
+		size_t iFirstContig = _nextBatchContig;
+		if(iFirstContig >= contigs.size()) {
+			// an empty batch marks the end of the file
+			_bAllBatchesClaimed = true;
+			_parsedBatches[sequence] = pContigs;
+			_batchParsed.wakeAll();
+			continue;
+		}
+
+		uint64_t batchSize = 0;
+		while(_nextBatchContig < contigs.size() && batchSize < ACE_BATCH_SIZE) {
+			batchSize += max(contigs[_nextBatchContig].size, static_cast<uint64_t>(1));
+			_nextBatchContig++;
+		}
+		size_t cContigs = _nextBatchContig - iFirstContig;
+
+		_mutex.unlock();
+		parseBatch(lineReader, contigs[iFirstContig].offset, cContigs, *pContigs);
+		_mutex.lock();
+
+		_parsedBatches[sequence] = pContigs;
+		_batchParsed.wakeAll();
+	}
+	_mutex.unlock();
+}
+
+// hand out the parsed contigs in the order of the file
+Contig* ACEFile::takeParsedContig() {
+	if(_parsers.empty() && !_bParsedEOF) {
+		// the batches are taken from the contig index
+		if(_cReads == -1) {
+			collectStatistics();
+		}
+		startParsers();
+	}
+
+	while(_parsedContigs.empty() && !_bParsedEOF) {
+		_mutex.lock();
+		while(_parsedBatches.count(_nextTakeSequence) == 0) {
+			_batchParsed.wait(&_mutex);
+		}
+
+		list<Contig*>* pContigs = _parsedBatches[_nextTakeSequence];
+		_parsedBatches.erase(_nextTakeSequence);
+		_nextTakeSequence++;
+		_batchTaken.wakeAll();
+		_bParsedEOF = _bAllBatchesClaimed && _parsedBatches.empty() && _nextTakeSequence == _nextBatchSequence;
+		_mutex.unlock();
+
+		_parsedContigs.splice(_parsedContigs.end(), *pContigs);
+		delete pContigs;
+	}
+
+	if(_parsedContigs.empty()) {
+		stopParsers();
+		return NULL;
+	}
+
+	Contig* pContig = _parsedContigs.front();
+	_parsedContigs.pop_front();
+	return pContig;
+}
+
+// return the contig with the given name, using the offset in the contig index
+Contig* ACEFile::getContig(const string& name) {
+    if(_cReads == -1) {
+        collectStatistics();
+    }
+
+    const ContigIndexEntry* pEntry = _contigIndex.findContig(name);
+    if(pEntry == NULL) {
+        Logger::getLogger()->log(QSNP_WARNING, "contig not found in ACE file: " + name);
+        return NULL;
+    }
+
+    if(!openFile()) {
+        return NULL;
+    }
+
+    // after a seek the file is read serially
+    stopParsers();
+    _cParseThreads = 0;
+
+    if(!_lineReader.seek(pEntry->offset)) {
+        Logger::getLogger()->log(QSNP_ERROR, "could not seek to contig: " + name);
+        return NULL;
+    }
+
+    Contig* pContig = readContig(_lineReader);
+    if(pContig != NULL && pContig->getName() != name) {
+        delete pContig;
+        return NULL;
+    }
+
+    return pContig;
+}
+
+BLOCKLABEL ACEFile::getBlockLabel(const char* line, int length) {
+	if(length < 2 || (length > 2 && line[2] > ' ')) {
+		return UnknownTag;
+	}
+
+	if(line[0] == 'C' && line[1] == 'O') {
 		return CO;
 	}
-	if(line[0] == 'R' && line[1] == 'D' && line[2] <= ' ') {
+	if(line[0] == 'R' && line[1] == 'D') {
 		return RD;
 	}
-	if(line[0] == 'A' && line[1] == 'F' && line[2] <= ' ') {
+	if(line[0] == 'A' && line[1] == 'F') {
 		return AF;
 	}
-	if(line[0] == 'Q' && line[1] == 'A' && line[2] <= ' ') {
+	if(line[0] == 'Q' && line[1] == 'A') {
 		return QA;
 	}
-	if(line[0] == 'B' && line[1] == 'Q' && line[2] <= ' ') {
+	if(line[0] == 'B' && line[1] == 'Q') {
 		return BQ;
 	}
 
 	return UnknownTag;
 }
 
-Contig* ACEFile::parseContigLine(const string& line) {
-	string name, tag;
-	std::stringstream ssLine(line);
-	ssLine >> tag >> name;
-	return new Contig(name);
+// find the next whitespace separated field of a record and move past it
+bool ACEFile::nextField(const char*& position, const char* end, const char*& field, int& fieldLength) {
+	while(position < end && *position <= ' ') {
+		position++;
+	}
+
+	field = position;
+	while(position < end && *position > ' ') {
+		position++;
+	}
+
+	fieldLength = position - field;
+	return fieldLength > 0;
+}
+
+int ACEFile::fieldToInt(const char* field, int fieldLength) {
+	const char* end = field + fieldLength;
+	bool bNegative = (field < end && *field == '-');
+	if(bNegative) {
+		field++;
+	}
+
+	int value = 0;
+	for(; field < end && *field >= '0' && *field <= '9'; field++) {
+		value = value * 10 + (*field - '0');
+	}
+
+	return bNegative ? -value : value;
+}
+
+// the read name without the trailing fields after a '|'
+string ACEFile::readName(const char* field, int fieldLength) {
+	const char* delimiter = static_cast<const char*>(memchr(field, '|', fieldLength));
+	if(delimiter != NULL && delimiter > field) {
+		fieldLength = delimiter - field;
+	}
+
+	return string(field, fieldLength);
+}
+
+// CO <contig name> <# of bases> <# of reads> <# of base segments> <U or C>
+Contig* ACEFile::parseContigLine(const char* line, int length, int& cBases) {
+	const char* position = line;
+	const char* end = line + length;
+	const char* field;
+	int fieldLength;
+
+	nextField(position, end, field, fieldLength);
+	nextField(position, end, field, fieldLength);
+	Contig* pContig = new Contig(string(field, fieldLength));
+
+	cBases = nextField(position, end, field, fieldLength) ? fieldToInt(field, fieldLength) : 0;
+	return pContig;
 }
 
-SeqRead* ACEFile::parseReadLine(const string& line, Contig* pContig) {
+// RD <read name> <# of padded bases> <# of whole read info items> <# of read tags>
+SeqRead* ACEFile::parseReadLine(const char* line, int length, int& cBases, Contig* pContig, const vector<SeqRead*>& locatedReads, size_t& iNextRead) {
 	if (pContig == NULL) {
-		Logger::getLogger()->log(QSNP_ERROR, "Found a read line, but no active contig " + string(line));
+		Logger::getLogger()->log(QSNP_ERROR, "Found a read line, but no active contig " + string(line, length));
 
 		return NULL;
 	}
 
-	string name, tag;
-	std::stringstream ssLine(line);
-	ssLine >> tag >> name;
-	stripTrailingFields(name);
-	SeqRead* pRead = pContig->findRead(name);
+	const char* position = line;
+	const char* end = line + length;
+	const char* field;
+	int fieldLength;
 
-	return pRead;
+	nextField(position, end, field, fieldLength);
+	nextField(position, end, field, fieldLength);
+	string name = readName(field, fieldLength);
+
+	cBases = nextField(position, end, field, fieldLength) ? fieldToInt(field, fieldLength) : 0;
+
+	if(iNextRead < locatedReads.size() && locatedReads[iNextRead]->getName() == name) {
+		return locatedReads[iNextRead++];
+	}
+
+	return pContig->findRead(name);
 }
 
-SeqRead* ACEFile::parseReadLocationLine(const string& line, Contig* pContig) {
-	string tag, readName, CorU;
-	int position;
-	std::stringstream ssLine(line);
-	ssLine >> tag >> readName >> CorU >> position;
-	stripTrailingFields(readName);
-	SeqRead* pRead = new SeqRead(readName, pContig);
-	pRead->setStartPosition(position);
+// AF <read name> <C or U> <padded start consensus position>
+SeqRead* ACEFile::parseReadLocationLine(const char* line, int length, Contig* pContig) {
+	const char* position = line;
+	const char* end = line + length;
+	const char* field;
+	int fieldLength;
+
+	nextField(position, end, field, fieldLength);
+	nextField(position, end, field, fieldLength);
+	SeqRead* pRead = new (pContig) SeqRead(readName(field, fieldLength), pContig);
+
+	nextField(position, end, field, fieldLength);
+	nextField(position, end, field, fieldLength);
+	pRead->setStartPosition(fieldToInt(field, fieldLength));
 
 	return pRead;
 }
 
+// QA <qual clipping start> <qual clipping end> <align clipping start> <align clipping end>
+void ACEFile::parseQualitySegmentLine(const char* line, int length, SeqRead* pRead) {
+	const char* position = line;
+	const char* end = line + length;
+	const char* field;
+	int fieldLength;
 
-void ACEFile::parseQualitySegmentLine(const string& line, SeqRead* pRead) {
-	string tag, readName, CorU;
-	int startPosition;
-	int endPosition;
-	std::stringstream ssLine(line);
-	ssLine >> tag >> startPosition >> endPosition;
+	nextField(position, end, field, fieldLength);
+	nextField(position, end, field, fieldLength);
+	int startPosition = fieldToInt(field, fieldLength);
+	nextField(position, end, field, fieldLength);
+	int endPosition = fieldToInt(field, fieldLength);
 
 	pRead->setQualClip(startPosition, endPosition);
 }
 
-void ACEFile::stripTrailingFields(string& strIn) {
-	size_t stDelimiterPos = strIn.find_first_of("|");
-	if (stDelimiterPos > 0) {
-		strIn = strIn.substr(0,stDelimiterPos);
-    }
+// the base qualities of the contig, for the unpadded bases only
+void ACEFile::parseBaseQualityLine(const char* line, int length, vector<int>& qualities) {
+	const char* position = line;
+	const char* end = line + length;
+	const char* field;
+	int fieldLength;
+
+	while(nextField(position, end, field, fieldLength)) {
+		if(*field >= '0' && *field <= '9') {
+			qualities.push_back(fieldToInt(field, fieldLength));
+		}
+	}
 }
 
+// statistics come from the contig index if there is a valid one, otherwise
+// the file is scanned once and the index is written for the next run
 bool ACEFile::collectStatistics()
 {
-    if(!openFile()) {
+    _cReads = 0;
+    _cContigs = 0;
+    _readGroups.clear();
+
+    if(!_contigIndex.load() && !buildIndex()) {
         return false;
     }
 
-    _ifACEFile.seekg (0, ios::beg);
+    _cReads = _contigIndex.getReadCount();
+    _cContigs = _contigIndex.getContigCount();
+    _readGroups = _contigIndex.getReadGroups();
+    sort(_readGroups.begin(), _readGroups.end());
 
-    _cReads = 0;
-    _cContigs = 0;
-    _readGroups.clear();
+    return true;
+}
 
-    map<string, int> groupMap;
+bool ACEFile::buildIndex()
+{
+    _contigIndex.clear();
 
-    string readNameGroupSeparator = Configuration::getConfig()->getString("readNameGroupSeparator");
+    // use a reader of its own, so the position of the contig reader is kept
+    LineReader lineReader(_contigFilename);
+    if(!lineReader.openFile()) {
+        return false;
+    }
 
-    string line;
+    string readNameGroupSeparator = Configuration::getConfig()->getString("readNameGroupSeparator");
+    ContigIndexEntry* pEntry = NULL;
+    const char* text;
+    int length;
+    uint64_t lineOffset = lineReader.tell();
+
+    for(; lineReader.nextLine(text, length); lineOffset = lineReader.tell()) {
+        // only the CO and RD lines matter, skip sequence lines without copying them
+        if (length < 3 || (text[0] != 'C' && text[0] != 'R')) {
+            continue;
+        }
 
-    while(getline(_ifACEFile,line)) {
-        if (!emptyLine(line)) {
-            switch (getBlockLabel(line)){
-            case CO:
-                _cContigs++;
-                break;
-            case RD:
-                _cReads++;
-                if(!readNameGroupSeparator.empty()) {
-                    string name, tag;
-                    std::stringstream ssLine(line);
-                    ssLine >> tag >> name;
-                    stripTrailingFields(name);
-                    SeqRead read(name);
-                    string group = read.getGroupFromName(readNameGroupSeparator);
-                    if(!group.empty()){
-                        groupMap[group]++;
-                    }
-                }
-            default:
+        const char* position = text;
+        const char* end = text + length;
+        const char* field;
+        int fieldLength;
+
+        switch (getBlockLabel(text, length)){
+        case CO:
+            nextField(position, end, field, fieldLength);
+            nextField(position, end, field, fieldLength);
+            if(pEntry != NULL) {
+                pEntry->size = lineOffset - pEntry->offset;
+            }
+            pEntry = &_contigIndex.addContig(string(field, fieldLength), lineOffset);
+            pEntry->length = nextField(position, end, field, fieldLength) ? fieldToInt(field, fieldLength) : 0;
+            break;
+        case RD:
+            if(pEntry == NULL) {
                 break;
             }
+            nextField(position, end, field, fieldLength);
+            nextField(position, end, field, fieldLength);
+            _contigIndex.addRead(*pEntry, readNameGroupSeparator.empty() ? string() : SeqRead(readName(field, fieldLength)).getGroupFromName(readNameGroupSeparator));
+            break;
+        default:
+            break;
         }
     }
 
-    map<string,int>::iterator itGroupMap;
-    for(itGroupMap = groupMap.begin(); itGroupMap != groupMap.end(); itGroupMap++) {
-        _readGroups.push_back((*itGroupMap).first);
+    if(pEntry != NULL) {
+        pEntry->size = lineOffset - pEntry->offset;
     }
 
-    _ifACEFile.clear();
-    _ifACEFile.seekg (0, ios::beg);
+    _contigIndex.save();
     return true;
 }
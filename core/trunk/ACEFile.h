@@ -23,6 +23,14 @@
 
 #include <string>
 #include <fstream>
+#include <vector>
+#include <list>
+#include <map>
+#include <stdint.h>
+#include <QMutex>
+#include <QWaitCondition>
+#include "LineReader.h"
+#include "ContigIndex.h"
 #include "ContigFile.h"
 
 static const int MAX_LINE_LENGTH = 4000;
@@ -38,6 +46,11 @@ typedef enum BlockLabel {
 
 using namespace std;
 
+class ACEParser;
+
+// reader for ACE assembly files. The contig index holds the position of
+// every CO block, so contigs can be read directly by name and with more
+// than one parsing thread batches of contig blocks are parsed in parallel
 class ACEFile : public ContigFile
 {
 public:
@@ -45,6 +58,7 @@ public:
 	~ACEFile(void);
 
 	Contig* nextContig();
+	Contig* getContig(const string& name);
 	bool openFile();
 	bool isValid();
     int  readCount();
@@ -52,23 +66,49 @@ public:
     vector<string>& readGroups();
 
 private:
-	bool emptyLine(const string&);
-	Contig* parseContigLine(const string&);
-	SeqRead* parseReadLine(const string&, Contig*);
-	SeqRead* parseReadLocationLine(const string&, Contig*);
-	void parseQualitySegmentLine(const string&, SeqRead*);
-	void stripTrailingFields(string&);
+	friend class ACEParser;
+
+	Contig* readContig(LineReader& lineReader);
+	void parseBatch(LineReader& lineReader, uint64_t start, size_t cContigs, list<Contig*>& contigs);
+	Contig* takeParsedContig();
+	void startParsers();
+	void stopParsers();
+	void runParser();
+	Contig* parseContigLine(const char* line, int length, int& cBases);
+	SeqRead* parseReadLine(const char* line, int length, int& cBases, Contig*, const vector<SeqRead*>& locatedReads, size_t& iNextRead);
+	SeqRead* parseReadLocationLine(const char* line, int length, Contig*);
+	void parseQualitySegmentLine(const char* line, int length, SeqRead*);
+	void parseBaseQualityLine(const char* line, int length, vector<int>& qualities);
+	bool nextField(const char*& position, const char* end, const char*& field, int& fieldLength);
+	int fieldToInt(const char* field, int fieldLength);
+	string readName(const char* field, int fieldLength);
     bool collectStatistics();
+    bool buildIndex();
 	
 private:
     string          _contigFilename;
-    ifstream        _ifACEFile;
-    Contig*         _pContig;
+    LineReader      _lineReader;
+    ContigIndex     _contigIndex;
     int             _cReads;
     int             _cContigs;
     vector<string>  _readGroups;
 
-	BLOCKLABEL getBlockLabel(const string&);
+    // parser pool, reading batches of the contig blocks in the contig index
+    int                         _cParseThreads;
+    vector<ACEParser*>          _parsers;
+    QMutex                      _mutex;
+    QWaitCondition              _batchParsed;
+    QWaitCondition              _batchTaken;
+    map<int64_t, list<Contig*>*> _parsedBatches;
+    list<Contig*>               _parsedContigs;
+    int64_t                     _nextBatchSequence;
+    int64_t                     _nextTakeSequence;
+    size_t                      _nextBatchContig;
+    bool                        _bAllBatchesClaimed;
+    bool                        _bParsedEOF;
+    bool                        _bStopParsers;
+
+	BLOCKLABEL getBlockLabel(const char* line, int length);
 };
 
 #endif
@@ -0,0 +1,674 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <list>
+#include <map>
+#include <algorithm>
+#include "HaploType.h"
+#include "SeqRead.h"
+#include "Contig.h"
+#include "Variation.h"
+#include "SAMRead.h"
+#include "SAMContig.h"
+#include "RegionList.h"
+#include "ReferenceFile.h"
+#include "BAMFile.h"
+
+// fixed length part of a BAM alignment record, following the block_size field
+static const int BAM_CORE_SIZE = 32;
+
+// bin holding the meta data of a reference in a BAI index
+static const uint32_t BAI_PSEUDO_BIN = 37450;
+
+static const uint64_t NO_OFFSET = ~static_cast<uint64_t>(0);
+
+// BAM stores integers little endian, like the platforms we run on
+template <class T>
+static T readValue(const char* data) {
+	T value;
+	memcpy(&value, data, sizeof(T));
+	return value;
+}
+
+// read a value from an index in memory, moving the position past it
+template <class T>
+static bool takeValue(const char*& p, const char* end, T& value) {
+	if(p + sizeof(T) > end) {
+		return false;
+	}
+	memcpy(&value, p, sizeof(T));
+	p += sizeof(T);
+	return true;
+}
+
+BAMFile::BAMFile(const string& contigFilename): _contigFilename(contigFilename),
+  _bgzfFile(contigFilename, Configuration::getConfig()->getInt("decompressionThreads")),
+  _contigIndex(contigFilename), _firstRecordOffset(0), _bIndexLoaded(false), _bHeaderRead(false),
+  _pRegions(NULL), _pReference(NULL), _pRead(NULL), _cReads(-1), _cContigs(-1),
+  _includeFlags(Configuration::getConfig()->getInt("includeFlags")),
+  _excludeFlags(Configuration::getConfig()->getInt("excludeFlags")),
+  _minimalMappingQuality(Configuration::getConfig()->getInt("minimalMappingQuality"))
+{
+}
+
+BAMFile::~BAMFile(void)
+{
+	delete _pRead;
+}
+
+bool BAMFile::openFile() {
+	if(!_bgzfFile.openFile()) {
+		return false;
+	}
+
+	if(!_bHeaderRead) {
+		_bHeaderRead = readHeader();
+	}
+
+	return _bHeaderRead;
+}
+
+// a BAM file is a BGZF file of which the uncompressed stream starts with "BAM\1"
+bool BAMFile::isValid() {
+	if(!BGZFFile::isBGZF(_contigFilename)) {
+		return false;
+	}
+
+	BGZFFile bgzfFile(_contigFilename);
+	if(!bgzfFile.openFile()) {
+		return false;
+	}
+
+	char magic[4];
+	return bgzfFile.read(magic, 4) == 4 && memcmp(magic, "BAM\1", 4) == 0;
+}
+
+// read the header with the reference names, the text header is skipped
+bool BAMFile::readHeader() {
+	char magic[4];
+	if(_bgzfFile.read(magic, 4) != 4 || memcmp(magic, "BAM\1", 4) != 0) {
+		Logger::getLogger()->log(QSNP_ERROR, "not a BAM file: " + _contigFilename);
+		return false;
+	}
+
+	char buffer[4];
+	if(_bgzfFile.read(buffer, 4) != 4) {
+		Logger::getLogger()->log(QSNP_ERROR, "truncated BAM header in file: " + _contigFilename);
+		return false;
+	}
+
+	int textLength = readValue<int32_t>(buffer);
+	vector<char> text(textLength + 1);
+	if(_bgzfFile.read(&text[0], textLength) != textLength || _bgzfFile.read(buffer, 4) != 4) {
+		Logger::getLogger()->log(QSNP_ERROR, "truncated BAM header in file: " + _contigFilename);
+		return false;
+	}
+
+	int cReferences = readValue<int32_t>(buffer);
+	_referenceNames.clear();
+	_referenceMap.clear();
+	_referenceNames.reserve(cReferences);
+	for(int iRef = 0; iRef < cReferences; iRef++) {
+		if(_bgzfFile.read(buffer, 4) != 4) {
+			Logger::getLogger()->log(QSNP_ERROR, "truncated BAM reference list in file: " + _contigFilename);
+			return false;
+		}
+
+		int nameLength = readValue<int32_t>(buffer);
+		vector<char> name(nameLength + 1);
+		if(_bgzfFile.read(&name[0], nameLength) != nameLength || _bgzfFile.read(buffer, 4) != 4) {
+			Logger::getLogger()->log(QSNP_ERROR, "truncated BAM reference list in file: " + _contigFilename);
+			return false;
+		}
+		_referenceMap[string(&name[0])] = _referenceNames.size();
+		_referenceNames.push_back(string(&name[0]));
+	}
+
+	_firstRecordOffset = _bgzfFile.tell();
+	return true;
+}
+
+// load the offset of the first record of every reference from a BAI or CSI index
+bool BAMFile::loadIndex() {
+	if(_bIndexLoaded) {
+		return true;
+	}
+
+	string baseName = _contigFilename;
+	if(baseName.size() > 4 && baseName.compare(baseName.size() - 4, 4, ".bam") == 0) {
+		baseName.erase(baseName.size() - 4);
+	}
+
+	string indexFilenames[] = {_contigFilename + ".bai", baseName + ".bai", _contigFilename + ".csi"};
+	for(unsigned int iFile = 0; iFile < sizeof(indexFilenames) / sizeof(indexFilenames[0]); iFile++) {
+		vector<char> data;
+		if(readIndexFile(indexFilenames[iFile], data)) {
+			if(parseIndex(data)) {
+				Logger::getLogger()->log(QSNP_INFO, "using BAM index: " + indexFilenames[iFile]);
+				_bIndexLoaded = true;
+				return true;
+			}
+			Logger::getLogger()->log(QSNP_WARNING, "ignoring invalid BAM index: " + indexFilenames[iFile]);
+		}
+	}
+
+	return false;
+}
+
+// read a whole index file, CSI indices are BGZF compressed
+bool BAMFile::readIndexFile(const string& indexFilename, vector<char>& data) {
+	if(BGZFFile::isBGZF(indexFilename)) {
+		BGZFFile bgzfFile(indexFilename);
+		if(!bgzfFile.openFile()) {
+			return false;
+		}
+
+		char buffer[BGZF_MAX_BLOCK_SIZE];
+		int cRead;
+		while((cRead = bgzfFile.read(buffer, sizeof(buffer))) > 0) {
+			data.insert(data.end(), buffer, buffer + cRead);
+		}
+		return true;
+	}
+
+	ifstream ifIndex(indexFilename.c_str(), ios::in | ios::binary);
+	if(ifIndex.fail()) {
+		return false;
+	}
+
+	data.assign(istreambuf_iterator<char>(ifIndex), istreambuf_iterator<char>());
+	return true;
+}
+
+// the first record of a reference is at the smallest chunk start of its bins
+bool BAMFile::parseIndex(const vector<char>& data) {
+	if(data.size() < 8) {
+		return false;
+	}
+
+	const char* p = &data[0];
+	const char* end = p + data.size();
+	bool bCSI = memcmp(p, "CSI\1", 4) == 0;
+	if(!bCSI && memcmp(p, "BAI\1", 4) != 0) {
+		return false;
+	}
+	p += 4;
+
+	uint32_t pseudoBin = BAI_PSEUDO_BIN;
+	if(bCSI) {
+		int32_t minShift, depth, auxLength;
+		if(!takeValue(p, end, minShift) || !takeValue(p, end, depth) || !takeValue(p, end, auxLength)
+				|| auxLength < 0 || p + auxLength > end) {
+			return false;
+		}
+		pseudoBin = ((1 << ((depth + 1) * 3)) - 1) / 7 + 1;
+		p += auxLength;
+	}
+
+	int32_t cReferences;
+	if(!takeValue(p, end, cReferences) || cReferences < 0) {
+		return false;
+	}
+
+	vector<uint64_t> referenceOffsets(cReferences, NO_OFFSET);
+	for(int iRef = 0; iRef < cReferences; iRef++) {
+		int32_t cBins;
+		if(!takeValue(p, end, cBins)) {
+			return false;
+		}
+
+		for(int iBin = 0; iBin < cBins; iBin++) {
+			uint32_t bin;
+			uint64_t leftOffset;
+			int32_t cChunks;
+			if(!takeValue(p, end, bin) || (bCSI && !takeValue(p, end, leftOffset)) || !takeValue(p, end, cChunks)) {
+				return false;
+			}
+
+			for(int iChunk = 0; iChunk < cChunks; iChunk++) {
+				uint64_t chunkBegin, chunkEnd;
+				if(!takeValue(p, end, chunkBegin) || !takeValue(p, end, chunkEnd)) {
+					return false;
+				}
+				if(bin != pseudoBin && chunkBegin < referenceOffsets[iRef]) {
+					referenceOffsets[iRef] = chunkBegin;
+				}
+			}
+		}
+
+		if(!bCSI) {
+			// the linear index is not needed to find the start of a reference
+			int32_t cIntervals;
+			if(!takeValue(p, end, cIntervals) || cIntervals < 0 || p + 8 * static_cast<size_t>(cIntervals) > end) {
+				return false;
+			}
+			p += 8 * static_cast<size_t>(cIntervals);
+		}
+	}
+
+	_referenceOffsets.swap(referenceOffsets);
+	return true;
+}
+
+// return the contig with the given name, the position of its first record
+// comes from a BAI or CSI index, or else from the contig index
+Contig* BAMFile::getContig(const string& name) {
+	if(!openFile()) {
+		return NULL;
+	}
+
+	uint64_t offset = NO_OFFSET;
+	map<string,int>::iterator itRef = _referenceMap.find(name);
+	if(itRef != _referenceMap.end() && loadIndex()) {
+		if(itRef->second < static_cast<int>(_referenceOffsets.size())) {
+			offset = _referenceOffsets[itRef->second];
+		}
+	} else {
+		if(_cReads == -1) {
+			collectStatistics();
+		}
+		const ContigIndexEntry* pEntry = _contigIndex.findContig(name);
+		if(pEntry != NULL) {
+			offset = pEntry->offset;
+		}
+	}
+
+	if(offset == NO_OFFSET) {
+		Logger::getLogger()->log(QSNP_WARNING, "contig not found in BAM file: " + name);
+		return NULL;
+	}
+
+	if(!_bgzfFile.seek(offset)) {
+		Logger::getLogger()->log(QSNP_ERROR, "could not seek to contig: " + name);
+		return NULL;
+	}
+
+	delete _pRead;
+	_pRead = NULL;
+
+	// a contig of only low mapping quality reads gives the next contig
+	Contig* pContig = nextContig();
+	if(pContig != NULL && pContig->getName() != name) {
+		delete pContig;
+		return NULL;
+	}
+
+	return pContig;
+}
+
+// read the next raw alignment record, without the leading block_size field
+bool BAMFile::readRecord(vector<char>& record) {
+	char buffer[4];
+	int cRead = _bgzfFile.read(buffer, 4);
+	if(cRead == 0) {
+		return false;
+	}
+
+	if(cRead != 4) {
+		Logger::getLogger()->log(QSNP_ERROR, "truncated BAM record in file: " + _contigFilename);
+		return false;
+	}
+
+	int blockSize = readValue<int32_t>(buffer);
+	if(blockSize < BAM_CORE_SIZE) {
+		Logger::getLogger()->log(QSNP_ERROR, "invalid BAM record in file: " + _contigFilename);
+		return false;
+	}
+
+	record.resize(blockSize);
+	if(_bgzfFile.read(&record[0], blockSize) != blockSize) {
+		Logger::getLogger()->log(QSNP_ERROR, "truncated BAM record in file: " + _contigFilename);
+		return false;
+	}
+
+	return true;
+}
+
+// return the next contig in the BAM file, or NULL if there are no more contigs
+Contig* BAMFile::nextContig() {
+    Logger::getLogger()->log(QSNP_INFO, "BAMFile::nextContig()");
+	if(!openFile()) {
+		return NULL;
+	}
+
+	SAMContig contig;
+
+	if(_pRead != NULL) {
+		contig.setName(_pRead->getContigName());
+		contig.addRead(_pRead);
+		_pRead = NULL;
+	}
+
+	while(readRecord(_record)) {
+		SAMRead* pRead = parseRecord(_record, false);
+		if (pRead != NULL) {
+			if(contig.getName().empty()) {
+				contig.setName(pRead->getContigName());
+			}
+
+			if(pRead->getContigName() == contig.getName()) {
+				contig.addRead(pRead);
+			} else {
+				_pRead = pRead;
+				return finishContig(contig);
+			}
+		}
+	}
+
+	return finishContig(contig);
+}
+
+Contig* BAMFile::finishContig(SAMContig& contig) {
+	contig.stretchReads();
+	contig.mergeReadPairs();
+	if(_pReference == NULL || !contig.loadReferenceSequence(_pReference)) {
+		contig.constructReferenceSequence();
+	}
+	return contig.toContig();
+}
+
+// the read filters of the configuration: all include flags set, none of the
+// exclude flags set and a high enough mapping quality
+bool BAMFile::acceptRead(int flag, int mapQuality) {
+	return (flag & _includeFlags) == _includeFlags && (flag & _excludeFlags) == 0 && mapQuality >= _minimalMappingQuality;
+}
+
+SAMRead* BAMFile::parseRecord(const vector<char>& record, bool bCollectStatistics) {
+	const char* data = &record[0];
+	const char* end = data + record.size();
+
+	int refID			= readValue<int32_t>(data);
+	int nStart			= readValue<int32_t>(data + 4);
+	int readNameLength	= static_cast<unsigned char>(data[8]);
+	int nMapq			= static_cast<unsigned char>(data[9]);
+	int cCigarOps		= readValue<uint16_t>(data + 12);
+	int nFlag			= readValue<uint16_t>(data + 14);
+	int seqLength		= readValue<int32_t>(data + 16);
+
+	const char* readName = data + BAM_CORE_SIZE;
+	const char* cigar = readName + readNameLength;
+	const char* seq = cigar + 4 * cCigarOps;
+	const char* qual = seq + (seqLength + 1) / 2;
+	const char* aux = qual + seqLength;
+
+	if(aux > end || readNameLength == 0) {
+		Logger::getLogger()->log(QSNP_ERROR, "invalid BAM record in file: " + _contigFilename);
+		return NULL;
+	}
+
+	if(refID < 0 || refID >= static_cast<int>(_referenceNames.size())) {
+		return NULL;
+	}
+
+	if(!bCollectStatistics && !acceptRead(nFlag, nMapq)) {
+		Logger::getLogger()->log(QSNP_DEBUG, "Skipping read (" + string(readName, readNameLength - 1) + ") by flag or mapping quality");
+		return NULL;
+	}
+
+	// reads outside the target regions are skipped before anything is allocated
+	if(_pRegions != NULL && !bCollectStatistics) {
+		int nRegionEnd = nStart + max(referenceLength(record), 1);
+		if(!_pRegions->overlaps(_referenceNames[refID], nStart + 1, nRegionEnd)) {
+			return NULL;
+		}
+	}
+
+	SAMRead* pRead = new SAMRead(string(readName, readNameLength - 1));
+	pRead->setGroup(findReadGroup(aux, end));
+	pRead->setContigName(_referenceNames[refID]);
+
+	if(bCollectStatistics) {
+		return pRead;
+	}
+
+	Logger::getLogger()->log(QSNP_DEBUG, "parseRecord for read: " + pRead->getName() + " (" + pRead->getContigName() + ")");
+
+	static const char* seqCodes = "=ACMGRSVTWYHKDBN";
+	string sequence(seqLength, 'N');
+	for(int i = 0; i < seqLength; i++) {
+		unsigned char packed = seq[i / 2];
+		sequence[i] = seqCodes[(i % 2 == 0) ? packed >> 4 : packed & 0xF];
+	}
+
+	string quality;
+	if(seqLength > 0 && static_cast<unsigned char>(qual[0]) == 0xFF) {
+		quality = "*";
+	} else {
+		quality.resize(seqLength);
+		for(int i = 0; i < seqLength; i++) {
+			quality[i] = qual[i] + 33;
+		}
+	}
+
+	pRead->setSequence(sequence);
+	pRead->setStartPosition(nStart + 1); // BAM positions are zero-based
+	pRead->setQuality(quality);
+	pRead->setMapQuality(nMapq);
+
+	vector<uint32_t>& packedCigar = pRead->getCigar();
+	if(parseCigar(cigar, cCigarOps, packedCigar) && pRead->processOperations()) {
+		return pRead;
+	}
+
+	// something went wrong decoding the record, so delete read and return NULL
+	delete pRead;
+	return NULL;
+}
+
+// BAM files store the cigar packed already, it only has to be checked
+bool BAMFile::parseCigar(const char* cigar, int cOperations, vector<uint32_t>& packedCigar) {
+	if(cOperations == 0) {
+		Logger::getLogger()->log(QSNP_DEBUG, "skipping read without cigar operations");
+		return false;
+	}
+
+	packedCigar.resize(cOperations);
+	memcpy(&packedCigar[0], cigar, 4 * cOperations);
+	for(int iOp = 0; iOp < cOperations; iOp++) {
+		if(cigarOperation(packedCigar[iOp]) >= CIGAR_OPERATION_COUNT) {
+			Logger::getLogger()->log(QSNP_ERROR, "Invalid cigar operation in BAM file: " + _contigFilename);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// walk the optional fields and return the value of the RG tag, if present
+string BAMFile::findReadGroup(const char* aux, const char* end) {
+	while(aux + 3 <= end) {
+		char type = aux[2];
+		const char* value = aux + 3;
+		int size = 0;
+
+		switch(type) {
+			case 'A':
+			case 'c':
+			case 'C':
+				size = 1;
+				break;
+			case 's':
+			case 'S':
+				size = 2;
+				break;
+			case 'i':
+			case 'I':
+			case 'f':
+				size = 4;
+				break;
+			case 'Z':
+			case 'H': {
+				const char* valueEnd = static_cast<const char*>(memchr(value, '\0', end - value));
+				if(valueEnd == NULL) {
+					return string();
+				}
+				if(aux[0] == 'R' && aux[1] == 'G' && type == 'Z') {
+					return string(value, valueEnd - value);
+				}
+				size = valueEnd - value + 1;
+				break;
+			}
+			case 'B': {
+				if(value + 5 > end) {
+					return string();
+				}
+				char subType = value[0];
+				int count = readValue<int32_t>(value + 1);
+				int elementSize = (subType == 'c' || subType == 'C') ? 1 : (subType == 's' || subType == 'S') ? 2 : 4;
+				size = 5 + count * elementSize;
+				break;
+			}
+			default:
+				return string();
+		}
+
+		aux = value + size;
+	}
+
+	return string();
+}
+
+// statistics come from the contig index if there is a valid one, otherwise
+// the file is scanned once and the index is written for the next run
+bool BAMFile::collectStatistics()
+{
+	_cReads = 0;
+	_cContigs = 0;
+	_readGroups.clear();
+
+	if(!_contigIndex.load() && !buildIndex()) {
+		return false;
+	}
+
+	_cReads = _contigIndex.getReadCount();
+	_cContigs = _contigIndex.getContigCount();
+	_readGroups = _contigIndex.getReadGroups();
+	sort(_readGroups.begin(), _readGroups.end());
+
+	return true;
+}
+
+bool BAMFile::buildIndex()
+{
+	_contigIndex.clear();
+
+	BAMFile bamFile(_contigFilename);
+	if(!bamFile.openFile()) {
+		return false;
+	}
+
+	int refID = -1;
+	ContigIndexEntry* pEntry = NULL;
+	vector<char> record;
+	uint64_t recordOffset = bamFile._bgzfFile.tell();
+
+	for(; bamFile.readRecord(record); recordOffset = bamFile._bgzfFile.tell()) {
+		const char* data = &record[0];
+		int recordRefID = readValue<int32_t>(data);
+		if(recordRefID < 0 || recordRefID >= static_cast<int>(bamFile._referenceNames.size())) {
+			continue;
+		}
+
+		if(pEntry == NULL || recordRefID != refID) {
+			refID = recordRefID;
+			pEntry = &_contigIndex.addContig(bamFile._referenceNames[refID], recordOffset);
+		}
+		_contigIndex.addRead(*pEntry, findReadGroup(recordAux(record), data + record.size()));
+
+		int readEnd = readValue<int32_t>(data + 4) + referenceLength(record);
+		if(readEnd > pEntry->length) {
+			pEntry->length = readEnd;
+		}
+	}
+
+	_contigIndex.save();
+	return true;
+}
+
+// start of the optional fields of a raw alignment record
+const char* BAMFile::recordAux(const vector<char>& record) {
+	const char* data = &record[0];
+	int readNameLength	= static_cast<unsigned char>(data[8]);
+	int cCigarOps		= readValue<uint16_t>(data + 12);
+	int seqLength		= readValue<int32_t>(data + 16);
+	const char* aux = data + BAM_CORE_SIZE + readNameLength + 4 * cCigarOps + (seqLength + 1) / 2 + seqLength;
+
+	return aux < data + record.size() ? aux : data + record.size();
+}
+
+// the number of reference positions covered by the cigar of a raw alignment record
+int BAMFile::referenceLength(const vector<char>& record) {
+	const char* data = &record[0];
+	int readNameLength	= static_cast<unsigned char>(data[8]);
+	int cCigarOps		= readValue<uint16_t>(data + 12);
+	const char* cigar = data + BAM_CORE_SIZE + readNameLength;
+	if(cigar + 4 * cCigarOps > data + record.size()) {
+		return 0;
+	}
+
+	int cPositions = 0;
+	for(int iOp = 0; iOp < cCigarOps; iOp++) {
+		uint32_t encoded = readValue<uint32_t>(cigar + 4 * iOp);
+		switch(encoded & 0xF) {
+			case 0: // M
+			case 2: // D
+			case 3: // N
+			case 7: // =
+			case 8: // X
+				cPositions += encoded >> 4;
+				break;
+			default:
+				break;
+		}
+	}
+
+	return cPositions;
+}
+
+int BAMFile::readCount()
+{
+    if(_cReads == -1) {
+        collectStatistics();
+    }
+
+    return _cReads;
+}
+
+int BAMFile::contigCount()
+{
+    if(_cContigs == -1) {
+        collectStatistics();
+    }
+
+    return _cContigs;
+}
+
+vector<string> &BAMFile::readGroups()
+{
+    if(_cReads == -1) {
+        collectStatistics();
+    }
+
+    return _readGroups;
+}
@@ -0,0 +1,90 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __BAMFILE_H__
+#define __BAMFILE_H__
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <stdint.h>
+#include "SAMRead.h"
+#include "BGZFFile.h"
+#include "ContigIndex.h"
+#include "ContigFile.h"
+
+class SAMContig;
+
+class BAMFile : public ContigFile
+{
+public:
+	BAMFile(const string& name);
+	~BAMFile(void);
+
+	Contig* nextContig();
+	Contig* getContig(const string& name);
+	void setRegions(RegionList* pRegions) { _pRegions = pRegions; }
+	void setReference(ReferenceFile* pReference) { _pReference = pReference; }
+	bool openFile();
+	bool isValid();
+    int  readCount();
+    int contigCount();
+    vector<string>& readGroups();
+
+private:
+	bool readHeader();
+	bool loadIndex();
+	bool readIndexFile(const string& indexFilename, vector<char>& data);
+	bool parseIndex(const vector<char>& data);
+	bool readRecord(vector<char>& record);
+	bool acceptRead(int flag, int mapQuality);
+	Contig* finishContig(SAMContig& contig);
+	SAMRead* parseRecord(const vector<char>& record, bool bCollectStatistics);
+	bool parseCigar(const char* cigar, int cOperations, vector<uint32_t>& packedCigar);
+	string findReadGroup(const char* aux, const char* end);
+	const char* recordAux(const vector<char>& record);
+	int referenceLength(const vector<char>& record);
+	bool collectStatistics();
+	bool buildIndex();
+
+private:
+    string          _contigFilename;
+    BGZFFile        _bgzfFile;
+    ContigIndex     _contigIndex;
+    vector<string>  _referenceNames;
+    vector<char>    _record;
+    uint64_t        _firstRecordOffset;
+    map<string,int> _referenceMap;
+    vector<uint64_t> _referenceOffsets;
+    bool            _bIndexLoaded;
+    bool            _bHeaderRead;
+    RegionList*     _pRegions;
+    ReferenceFile*  _pReference;
+    SAMRead*        _pRead;
+    int             _cReads;
+    int             _cContigs;
+    vector<string>  _readGroups;
+    int             _includeFlags;
+    int             _excludeFlags;
+    int             _minimalMappingQuality;
+};
+
+#endif
@@ -0,0 +1,434 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <zlib.h>
+#include <QThread>
+#include "Logger.h"
+#include "BGZFFile.h"
+
+using namespace std;
+
+// number of blocks each inflater thread may work ahead of the reader
+static const int BGZF_BLOCKS_AHEAD = 4;
+
+class BGZFInflater : public QThread
+{
+public:
+	BGZFInflater(BGZFFile* pFile): _pFile(pFile) {}
+
+protected:
+	void run() { _pFile->runInflater(); }
+
+private:
+	BGZFFile* _pFile;
+};
+
+BGZFFile::BGZFFile(const string& filename, int cThreads): _filename(filename), _blockOffset(0), _bEOF(false),
+  _cThreads(cThreads), _nextReadSequence(0), _nextTakeSequence(0), _nextBlockAddress(0), _bFileEOF(false),
+  _bStopInflaters(false)
+{
+	_block.address = 0;
+	_block.nextAddress = 0;
+	_block.length = 0;
+	_block.bEOF = false;
+	_block.bError = false;
+}
+
+BGZFFile::~BGZFFile(void)
+{
+	stopInflaters();
+}
+
+bool BGZFFile::openFile() {
+	if(_ifFile.is_open()) {
+		return true;
+	}
+
+	_ifFile.open(_filename.c_str(), ios::in | ios::binary);
+	if (_ifFile.fail()) {
+		Logger::getLogger()->log(QSNP_ERROR, "could not open file: " + _filename);
+		return false;
+	}
+
+	return true;
+}
+
+// check the gzip magic and the "BC" extra field that marks a BGZF block
+bool BGZFFile::isBGZF(const string& filename) {
+	ifstream ifFile(filename.c_str(), ios::in | ios::binary);
+	unsigned char header[BGZF_HEADER_SIZE];
+	if(!ifFile.read(reinterpret_cast<char*>(header), BGZF_HEADER_SIZE)) {
+		return false;
+	}
+
+	return header[0] == 31 && header[1] == 139 && header[2] == 8 && (header[3] & 4) != 0
+		&& header[12] == 'B' && header[13] == 'C';
+}
+
+// read the next compressed block from the file, without inflating it
+// the compressed data is stored in the data buffer of the block
+bool BGZFFile::readRawBlock(BGZFBlock* pBlock) {
+	unsigned char header[BGZF_HEADER_SIZE];
+
+	pBlock->address = _nextBlockAddress;
+	pBlock->nextAddress = _nextBlockAddress;
+	pBlock->length = 0;
+	pBlock->bEOF = false;
+	pBlock->bError = false;
+
+	if(!_ifFile.read(reinterpret_cast<char*>(header), BGZF_HEADER_SIZE)) {
+		pBlock->bEOF = true;
+		if(_ifFile.gcount() != 0) {
+			Logger::getLogger()->log(QSNP_ERROR, "truncated BGZF block in file: " + _filename);
+			pBlock->bError = true;
+		}
+		return false;
+	}
+
+	pBlock->bError = true;
+	if(header[0] != 31 || header[1] != 139 || header[12] != 'B' || header[13] != 'C') {
+		Logger::getLogger()->log(QSNP_ERROR, "invalid BGZF block header in file: " + _filename);
+		return false;
+	}
+
+	int extraLength = header[10] | (header[11] << 8);
+	int blockSize = (header[16] | (header[17] << 8)) + 1;
+	int remaining = blockSize - BGZF_HEADER_SIZE;
+	if(extraLength != 6 || remaining < BGZF_FOOTER_SIZE || blockSize > BGZF_MAX_BLOCK_SIZE) {
+		Logger::getLogger()->log(QSNP_ERROR, "unsupported BGZF block layout in file: " + _filename);
+		return false;
+	}
+
+	pBlock->data.resize(remaining);
+	if(!_ifFile.read(&pBlock->data[0], remaining)) {
+		Logger::getLogger()->log(QSNP_ERROR, "truncated BGZF block in file: " + _filename);
+		return false;
+	}
+
+	_nextBlockAddress += blockSize;
+	pBlock->nextAddress = _nextBlockAddress;
+	pBlock->bError = false;
+	return true;
+}
+
+// inflate the compressed data of a block in place
+bool BGZFFile::inflateBlock(BGZFBlock* pBlock) {
+	int compressedSize = pBlock->data.size() - BGZF_FOOTER_SIZE;
+	const unsigned char* footer = reinterpret_cast<unsigned char*>(&pBlock->data[compressedSize]);
+	int uncompressedSize = footer[4] | (footer[5] << 8) | (footer[6] << 16) | (footer[7] << 24);
+
+	if(uncompressedSize > BGZF_MAX_BLOCK_SIZE) {
+		Logger::getLogger()->log(QSNP_ERROR, "BGZF block too large in file: " + _filename);
+		pBlock->bError = true;
+		return false;
+	}
+
+	vector<char> uncompressed(uncompressedSize + 1);
+	if(uncompressedSize > 0) {
+		z_stream zs;
+		memset(&zs, 0, sizeof(zs));
+		zs.next_in = reinterpret_cast<Bytef*>(&pBlock->data[0]);
+		zs.avail_in = compressedSize;
+		zs.next_out = reinterpret_cast<Bytef*>(&uncompressed[0]);
+		zs.avail_out = uncompressedSize;
+
+		if(inflateInit2(&zs, -15) != Z_OK) {
+			Logger::getLogger()->log(QSNP_ERROR, "could not initialize zlib for file: " + _filename);
+			pBlock->bError = true;
+			return false;
+		}
+
+		int status = inflate(&zs, Z_FINISH);
+		inflateEnd(&zs);
+
+		if(status != Z_STREAM_END || zs.total_out != static_cast<uLong>(uncompressedSize)) {
+			Logger::getLogger()->log(QSNP_ERROR, "corrupt BGZF block in file: " + _filename);
+			pBlock->bError = true;
+			return false;
+		}
+	}
+
+	pBlock->data.swap(uncompressed);
+	pBlock->length = uncompressedSize;
+	return true;
+}
+
+// make the next inflated block the current block
+bool BGZFFile::readBlock() {
+	_blockOffset = 0;
+	_block.length = 0;
+
+	if(_cThreads > 0) {
+		return takeInflatedBlock(&_block);
+	}
+
+	if(!readRawBlock(&_block) || !inflateBlock(&_block)) {
+		_bEOF = true;
+		return false;
+	}
+
+	return true;
+}
+
+void BGZFFile::startInflaters() {
+	_bStopInflaters = false;
+	for(int iThread = 0; iThread < _cThreads; iThread++) {
+		BGZFInflater* pInflater = new BGZFInflater(this);
+		_inflaters.push_back(pInflater);
+		pInflater->start();
+	}
+}
+
+void BGZFFile::stopInflaters() {
+	if(_inflaters.empty()) {
+		return;
+	}
+
+	_mutex.lock();
+	_bStopInflaters = true;
+	_blockTaken.wakeAll();
+	_mutex.unlock();
+
+	vector<BGZFInflater*>::iterator itInflaters;
+	for(itInflaters = _inflaters.begin(); itInflaters != _inflaters.end(); itInflaters++) {
+		(*itInflaters)->wait();
+		delete *itInflaters;
+	}
+	_inflaters.clear();
+
+	map<int64_t, BGZFBlock*>::iterator itBlocks;
+	for(itBlocks = _inflatedBlocks.begin(); itBlocks != _inflatedBlocks.end(); itBlocks++) {
+		delete itBlocks->second;
+	}
+	_inflatedBlocks.clear();
+}
+
+// the inflater threads take turns reading a compressed block from the file,
+// inflate it without holding the lock and hand it over by sequence number
+void BGZFFile::runInflater() {
+	int maxBlocksAhead = BGZF_BLOCKS_AHEAD * _cThreads;
+
+	_mutex.lock();
+	while(!_bStopInflaters) {
+		if(_bFileEOF || _nextReadSequence - _nextTakeSequence >= maxBlocksAhead) {
+			_blockTaken.wait(&_mutex);
+			continue;
+		}
+
+		int64_t sequence = _nextReadSequence++;
+		BGZFBlock* pBlock = new BGZFBlock();
+		if(!readRawBlock(pBlock)) {
+			_bFileEOF = true;
+			_inflatedBlocks[sequence] = pBlock;
+			_blockInflated.wakeAll();
+			continue;
+		}
+
+		_mutex.unlock();
+		inflateBlock(pBlock);
+		_mutex.lock();
+
+		_inflatedBlocks[sequence] = pBlock;
+		_blockInflated.wakeAll();
+	}
+	_mutex.unlock();
+}
+
+bool BGZFFile::takeInflatedBlock(BGZFBlock* pBlock) {
+	if(_bEOF) {
+		return false;
+	}
+
+	if(_inflaters.empty()) {
+		startInflaters();
+	}
+
+	_mutex.lock();
+	while(_inflatedBlocks.count(_nextTakeSequence) == 0) {
+		_blockInflated.wait(&_mutex);
+	}
+
+	BGZFBlock* pInflated = _inflatedBlocks[_nextTakeSequence];
+	_inflatedBlocks.erase(_nextTakeSequence);
+	_nextTakeSequence++;
+	_blockTaken.wakeAll();
+	_mutex.unlock();
+
+	pBlock->address = pInflated->address;
+	pBlock->nextAddress = pInflated->nextAddress;
+	pBlock->length = pInflated->length;
+	pBlock->bEOF = pInflated->bEOF;
+	pBlock->bError = pInflated->bError;
+	pBlock->data.swap(pInflated->data);
+	delete pInflated;
+
+	if(pBlock->bEOF || pBlock->bError) {
+		pBlock->length = 0;
+		_bEOF = true;
+		return false;
+	}
+
+	return true;
+}
+
+// read up to length uncompressed bytes, returns the number of bytes read
+int BGZFFile::read(void* buffer, int length) {
+	char* pOut = static_cast<char*>(buffer);
+	int cRead = 0;
+
+	while(cRead < length) {
+		if(_blockOffset >= _block.length) {
+			if(_bEOF || !readBlock()) {
+				break;
+			}
+			continue; // empty blocks, like the EOF marker, are skipped
+		}
+
+		int cCopy = min(length - cRead, _block.length - _blockOffset);
+		memcpy(pOut + cRead, &_block.data[_blockOffset], cCopy);
+		_blockOffset += cCopy;
+		cRead += cCopy;
+	}
+
+	return cRead;
+}
+
+// return the unread part of the current block without copying it
+// the data stays valid until the next call on this object
+bool BGZFFile::nextChunk(const char*& data, int& length, uint64_t& virtualOffset) {
+	if(eof()) {
+		return false;
+	}
+
+	virtualOffset = tell();
+	data = &_block.data[_blockOffset];
+	length = _block.length - _blockOffset;
+	_blockOffset = _block.length;
+	return true;
+}
+
+bool BGZFFile::eof() {
+	while(_blockOffset >= _block.length) {
+		if(_bEOF || !readBlock()) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint64_t BGZFFile::tell() {
+	if(_blockOffset >= _block.length) {
+		// at the end of a block the next read starts in the next block
+		return static_cast<uint64_t>(_block.nextAddress) << 16;
+	}
+
+	return (static_cast<uint64_t>(_block.address) << 16) | _blockOffset;
+}
+
+bool BGZFFile::seek(uint64_t virtualOffset) {
+	if(!openFile()) {
+		return false;
+	}
+
+	stopInflaters();
+
+	int64_t blockAddress = virtualOffset >> 16;
+	int blockOffset = virtualOffset & 0xFFFF;
+
+	_ifFile.clear();
+	_ifFile.seekg(blockAddress, ios::beg);
+	if(_ifFile.fail()) {
+		Logger::getLogger()->log(QSNP_ERROR, "could not seek in file: " + _filename);
+		return false;
+	}
+
+	_bEOF = false;
+	_bFileEOF = false;
+	_nextReadSequence = 0;
+	_nextTakeSequence = 0;
+	_nextBlockAddress = blockAddress;
+	_block.address = blockAddress;
+	_block.nextAddress = blockAddress;
+	_block.length = 0;
+	_blockOffset = 0;
+
+	if(!readBlock()) {
+		// seeking to the very end of the file is allowed
+		return blockOffset == 0;
+	}
+
+	if(blockOffset > _block.length) {
+		Logger::getLogger()->log(QSNP_ERROR, "invalid virtual offset in file: " + _filename);
+		return false;
+	}
+
+	_blockOffset = blockOffset;
+	return true;
+}
+
+BGZFStreamBuf::BGZFStreamBuf(const string& filename, int cThreads): _bgzfFile(filename, cThreads), _chunkOffset(0)
+{
+	setg(NULL, NULL, NULL);
+}
+
+// hand out the rest of the current block as the get area
+BGZFStreamBuf::int_type BGZFStreamBuf::underflow() {
+	if(gptr() < egptr()) {
+		return traits_type::to_int_type(*gptr());
+	}
+
+	const char* data;
+	int length;
+	if(!_bgzfFile.nextChunk(data, length, _chunkOffset)) {
+		return traits_type::eof();
+	}
+
+	char* pData = const_cast<char*>(data);
+	setg(pData, pData, pData + length);
+	return traits_type::to_int_type(*gptr());
+}
+
+BGZFStreamBuf::pos_type BGZFStreamBuf::seekoff(off_type offset, ios_base::seekdir direction, ios_base::openmode mode) {
+	if(offset == 0 && direction == ios_base::cur) {
+		// tellg, the get area never crosses a block boundary
+		if(gptr() == egptr()) {
+			return pos_type(off_type(_bgzfFile.tell()));
+		}
+		return pos_type(off_type(_chunkOffset + (gptr() - eback())));
+	}
+
+	if(direction == ios_base::beg) {
+		return seekpos(pos_type(offset), mode);
+	}
+
+	// relative seeks are not possible in a compressed stream
+	return pos_type(off_type(-1));
+}
+
+BGZFStreamBuf::pos_type BGZFStreamBuf::seekpos(pos_type position, ios_base::openmode) {
+	setg(NULL, NULL, NULL);
+	if(!_bgzfFile.seek(static_cast<uint64_t>(off_type(position)))) {
+		return pos_type(off_type(-1));
+	}
+
+	return position;
+}
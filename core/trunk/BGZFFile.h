@@ -0,0 +1,123 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __BGZFFILE_H__
+#define __BGZFFILE_H__
+
+#include <string>
+#include <fstream>
+#include <streambuf>
+#include <vector>
+#include <map>
+#include <stdint.h>
+#include <QMutex>
+#include <QWaitCondition>
+
+using namespace std;
+
+static const int BGZF_MAX_BLOCK_SIZE = 65536;
+static const int BGZF_HEADER_SIZE = 18;
+static const int BGZF_FOOTER_SIZE = 8;
+
+class BGZFInflater;
+
+struct BGZFBlock {
+	int64_t			address;
+	int64_t			nextAddress;
+	vector<char>	data;
+	int				length;
+	bool			bEOF;
+	bool			bError;
+};
+
+// reader for the blocked gzip format (BGZF) used by BAM files
+// positions in the uncompressed stream are given as virtual offsets:
+// the file offset of the compressed block in the upper 48 bits and
+// the offset within the uncompressed block in the lower 16 bits
+//
+// with cThreads > 0 a pool of inflater threads decompresses the blocks
+// ahead of the reader
+class BGZFFile
+{
+public:
+	BGZFFile(const string& filename, int cThreads = 0);
+	~BGZFFile(void);
+
+	bool openFile();
+	int read(void* buffer, int length);
+	bool nextChunk(const char*& data, int& length, uint64_t& virtualOffset);
+	bool eof();
+	uint64_t tell();
+	bool seek(uint64_t virtualOffset);
+
+	static bool isBGZF(const string& filename);
+
+private:
+	friend class BGZFInflater;
+
+	bool readBlock();
+	bool readRawBlock(BGZFBlock* pBlock);
+	bool inflateBlock(BGZFBlock* pBlock);
+	bool takeInflatedBlock(BGZFBlock* pBlock);
+	void startInflaters();
+	void stopInflaters();
+	void runInflater();
+
+private:
+	string						_filename;
+	ifstream					_ifFile;
+	BGZFBlock					_block;
+	int							_blockOffset;
+	bool						_bEOF;
+
+	// inflater pool, the file is only read while holding the mutex
+	int							_cThreads;
+	vector<BGZFInflater*>		_inflaters;
+	QMutex						_mutex;
+	QWaitCondition				_blockInflated;
+	QWaitCondition				_blockTaken;
+	map<int64_t, BGZFBlock*>	_inflatedBlocks;
+	int64_t						_nextReadSequence;
+	int64_t						_nextTakeSequence;
+	int64_t						_nextBlockAddress;
+	bool						_bFileEOF;
+	bool						_bStopInflaters;
+};
+
+// exposes the uncompressed contents of a BGZF file as a stream buffer, so
+// the line based readers can read compressed input. Stream positions are
+// BGZF virtual offsets.
+class BGZFStreamBuf : public streambuf
+{
+public:
+	BGZFStreamBuf(const string& filename, int cThreads = 0);
+	bool openFile() { return _bgzfFile.openFile(); }
+
+protected:
+	int_type underflow();
+	pos_type seekoff(off_type offset, ios_base::seekdir direction, ios_base::openmode mode);
+	pos_type seekpos(pos_type position, ios_base::openmode mode);
+
+private:
+	BGZFFile	_bgzfFile;
+	uint64_t	_chunkOffset;
+};
+
+#endif
@@ -116,7 +116,7 @@ void CSVReader::getReads(Contig* pContig, map<int, vector<SeqRead*> >& hapmap) {
 
         if(contigName == pContig->getName()) {
             bFound = true;
-            SeqRead* pRead = new SeqRead(name, pContig);
+            SeqRead* pRead = new (pContig) SeqRead(name, pContig);
             pRead->setSequence(sequence);
             pRead->setStartPosition(start + 1);
 
@@ -161,7 +161,7 @@ void CSVReader::getHaploTypes(Contig* pContig, map<int, vector<SeqRead*> >& hapm
 
         if(contigName == pContig->getName()) {
             bFound = true;
-            HaploType* pHaploType = new HaploType(pContig, hapid);
+            HaploType* pHaploType = new (pContig) HaploType(pContig, hapid);
             pContig->addHaploType(pHaploType);
             if(hapmap.count(hapid) != 0) {
                 vector<SeqRead*>::iterator itRead;
@@ -267,7 +267,7 @@ void CSVReader::getVariations(Contig* pContig) {
 
         if(contigName == pContig->getName()) {
             bFound = true;
-            Variation* pVariation = new Variation(pContig, position);
+            Variation* pVariation = new (pContig) Variation(pContig, position);
             pVariation->setMajorAllele(majAllele);
             pVariation->setMinorAllele(minAllele);
             pVariation->setIsDefining(defining);
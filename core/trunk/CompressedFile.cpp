@@ -0,0 +1,499 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <QThread>
+#include "Logger.h"
+#include "BGZFFile.h"
+#include "CompressedFile.h"
+
+using namespace std;
+
+// size of the uncompressed blocks handed to the reader
+static const int COMPRESSED_BLOCK_SIZE = 1 << 20;
+
+// size of the reads from the compressed file
+static const int COMPRESSED_INPUT_SIZE = 1 << 18;
+
+// number of blocks the decompressor thread may work ahead of the reader
+static const size_t COMPRESSED_BLOCKS_AHEAD = 4;
+
+class Decompressor : public QThread
+{
+public:
+	Decompressor(CompressedFile* pFile): _pFile(pFile) {}
+
+protected:
+	void run() { _pFile->runDecompressor(); }
+
+private:
+	CompressedFile* _pFile;
+};
+
+CompressedFile::CompressedFile(const string& filename, Compression compression, bool bBackground): _filename(filename),
+  _compression(compression), _blockOffset(0), _bEOF(false),
+#ifdef QSNP_HAVE_ZSTD
+  _pZstdStream(NULL),
+#endif
+  _bStreamOpen(false), _bStreamEnd(true), _inputStart(0), _inputEnd(0), _bInputEOF(false), _nextPosition(0),
+  _bBackground(bBackground), _pDecompressor(NULL), _bDecompressedEOF(false), _bStopDecompressor(false)
+{
+	_block.position = 0;
+	_block.length = 0;
+	_block.bEOF = false;
+	_block.bError = false;
+	memset(&_zStream, 0, sizeof(_zStream));
+}
+
+CompressedFile::~CompressedFile(void)
+{
+	stopDecompressor();
+	endStream();
+}
+
+bool CompressedFile::openFile() {
+	if(_ifFile.is_open()) {
+		return true;
+	}
+
+	if(!isSupported(_compression)) {
+		Logger::getLogger()->log(QSNP_ERROR, "reading " + compressionName(_compression) + " compressed files is not supported by this build: " + _filename);
+		return false;
+	}
+
+	_ifFile.open(_filename.c_str(), ios::in | ios::binary);
+	if (_ifFile.fail()) {
+		Logger::getLogger()->log(QSNP_ERROR, "could not open file: " + _filename);
+		return false;
+	}
+
+	_input.resize(COMPRESSED_INPUT_SIZE);
+	return initStream();
+}
+
+// recognize BGZF, gzip and zstd files by their magic bytes
+Compression CompressedFile::detectCompression(const string& filename) {
+	ifstream ifFile(filename.c_str(), ios::in | ios::binary);
+	unsigned char magic[4];
+	if(!ifFile.read(reinterpret_cast<char*>(magic), sizeof(magic))) {
+		return COMPRESSION_NONE;
+	}
+
+	if(magic[0] == 0x1f && magic[1] == 0x8b) {
+		return BGZFFile::isBGZF(filename) ? COMPRESSION_BGZF : COMPRESSION_GZIP;
+	}
+
+	if(magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+		return COMPRESSION_ZSTD;
+	}
+
+	return COMPRESSION_NONE;
+}
+
+string CompressedFile::compressionName(Compression compression) {
+	switch(compression) {
+	case COMPRESSION_BGZF:
+		return "BGZF";
+	case COMPRESSION_GZIP:
+		return "gzip";
+	case COMPRESSION_ZSTD:
+		return "zstd";
+	default:
+		return "uncompressed";
+	}
+}
+
+bool CompressedFile::isSupported(Compression compression) {
+#ifndef QSNP_HAVE_ZSTD
+	if(compression == COMPRESSION_ZSTD) {
+		return false;
+	}
+#endif
+	return true;
+}
+
+bool CompressedFile::initStream() {
+	endStream();
+
+	if(_compression == COMPRESSION_ZSTD) {
+#ifdef QSNP_HAVE_ZSTD
+		_pZstdStream = ZSTD_createDStream();
+		if(_pZstdStream == NULL || ZSTD_isError(ZSTD_initDStream(_pZstdStream))) {
+			Logger::getLogger()->log(QSNP_ERROR, "could not initialize zstd for file: " + _filename);
+			return false;
+		}
+#endif
+	} else {
+		memset(&_zStream, 0, sizeof(_zStream));
+		// a window of 15 bits with 16 added for the gzip header and trailer
+		if(inflateInit2(&_zStream, 15 + 16) != Z_OK) {
+			Logger::getLogger()->log(QSNP_ERROR, "could not initialize zlib for file: " + _filename);
+			return false;
+		}
+	}
+
+	_bStreamOpen = true;
+	_bStreamEnd = true;
+	return true;
+}
+
+void CompressedFile::endStream() {
+	if(!_bStreamOpen) {
+		return;
+	}
+
+#ifdef QSNP_HAVE_ZSTD
+	if(_pZstdStream != NULL) {
+		ZSTD_freeDStream(_pZstdStream);
+		_pZstdStream = NULL;
+	}
+#endif
+	if(_compression != COMPRESSION_ZSTD) {
+		inflateEnd(&_zStream);
+	}
+	_bStreamOpen = false;
+}
+
+// start decompressing at the beginning of the file again
+bool CompressedFile::restart() {
+	stopDecompressor();
+
+	_ifFile.clear();
+	_ifFile.seekg(0, ios::beg);
+	if(_ifFile.fail() || !initStream()) {
+		Logger::getLogger()->log(QSNP_ERROR, "could not seek in file: " + _filename);
+		return false;
+	}
+
+	_inputStart = 0;
+	_inputEnd = 0;
+	_bInputEOF = false;
+	_nextPosition = 0;
+	_bDecompressedEOF = false;
+	_bEOF = false;
+	_block.position = 0;
+	_block.length = 0;
+	_blockOffset = 0;
+	return true;
+}
+
+bool CompressedFile::readInput() {
+	_inputStart = 0;
+	_inputEnd = 0;
+	if(_bInputEOF) {
+		return false;
+	}
+
+	_ifFile.read(&_input[0], _input.size());
+	_inputEnd = _ifFile.gcount();
+	if(_inputEnd == 0) {
+		_bInputEOF = true;
+		return false;
+	}
+
+	return true;
+}
+
+// decompress the next block of the stream, reading compressed input as needed
+// an empty block marks the end of the stream. The data before an error is
+// returned first, the error is reported with the next block.
+bool CompressedFile::decompressBlock(DecompressedBlock* pBlock) {
+	pBlock->position = _nextPosition;
+	pBlock->data.resize(COMPRESSED_BLOCK_SIZE);
+	pBlock->length = 0;
+	pBlock->bEOF = false;
+	pBlock->bError = false;
+
+	while(pBlock->length < COMPRESSED_BLOCK_SIZE) {
+		if(_inputStart == _inputEnd) {
+			readInput();
+		}
+
+		size_t inputStart = _inputStart;
+		int length = pBlock->length;
+
+		if(_compression == COMPRESSION_ZSTD) {
+#ifdef QSNP_HAVE_ZSTD
+			ZSTD_inBuffer in = { &_input[_inputStart], _inputEnd - _inputStart, 0 };
+			ZSTD_outBuffer out = { &pBlock->data[pBlock->length], static_cast<size_t>(COMPRESSED_BLOCK_SIZE - pBlock->length), 0 };
+			size_t result = ZSTD_decompressStream(_pZstdStream, &out, &in);
+			if(ZSTD_isError(result)) {
+				if(pBlock->length == 0) {
+					Logger::getLogger()->log(QSNP_ERROR, string("corrupt zstd data in file: ") + _filename + ": " + ZSTD_getErrorName(result));
+					pBlock->bError = true;
+				}
+				break;
+			}
+			_inputStart += in.pos;
+			pBlock->length += out.pos;
+			// a frame is complete when nothing is left to flush
+			if(in.pos > 0 || out.pos > 0) {
+				_bStreamEnd = (result == 0);
+			}
+#endif
+		} else {
+			_zStream.next_in = reinterpret_cast<Bytef*>(&_input[_inputStart]);
+			_zStream.avail_in = _inputEnd - _inputStart;
+			_zStream.next_out = reinterpret_cast<Bytef*>(&pBlock->data[pBlock->length]);
+			_zStream.avail_out = COMPRESSED_BLOCK_SIZE - pBlock->length;
+
+			int status = inflate(&_zStream, Z_NO_FLUSH);
+			_inputStart = _inputEnd - _zStream.avail_in;
+			pBlock->length = COMPRESSED_BLOCK_SIZE - _zStream.avail_out;
+			if(_inputStart > inputStart) {
+				_bStreamEnd = false;
+			}
+
+			if(status == Z_STREAM_END) {
+				// another gzip member may follow
+				inflateReset(&_zStream);
+				_bStreamEnd = true;
+			} else if(status != Z_OK && status != Z_BUF_ERROR) {
+				if(pBlock->length == 0) {
+					Logger::getLogger()->log(QSNP_ERROR, "corrupt gzip data in file: " + _filename);
+					pBlock->bError = true;
+				}
+				break;
+			}
+		}
+
+		if(_inputStart == inputStart && pBlock->length == length && _bInputEOF) {
+			// no progress and no more input
+			if(!_bStreamEnd && pBlock->length == 0) {
+				Logger::getLogger()->log(QSNP_ERROR, "truncated " + compressionName(_compression) + " file: " + _filename);
+				pBlock->bError = true;
+			}
+			break;
+		}
+	}
+
+	_nextPosition += pBlock->length;
+	pBlock->bEOF = (pBlock->length == 0);
+	return !pBlock->bEOF && !pBlock->bError;
+}
+
+// make the next decompressed block the current block
+bool CompressedFile::readBlock() {
+	_blockOffset = 0;
+	_block.length = 0;
+
+	if(_bBackground) {
+		return takeDecompressedBlock();
+	}
+
+	if(!decompressBlock(&_block)) {
+		_block.length = 0;
+		_bEOF = true;
+		return false;
+	}
+
+	return true;
+}
+
+void CompressedFile::startDecompressor() {
+	_bStopDecompressor = false;
+	_pDecompressor = new Decompressor(this);
+	_pDecompressor->start();
+}
+
+void CompressedFile::stopDecompressor() {
+	if(_pDecompressor == NULL) {
+		return;
+	}
+
+	_mutex.lock();
+	_bStopDecompressor = true;
+	_blockTaken.wakeAll();
+	_mutex.unlock();
+
+	_pDecompressor->wait();
+	delete _pDecompressor;
+	_pDecompressor = NULL;
+
+	while(!_decompressedBlocks.empty()) {
+		delete _decompressedBlocks.front();
+		_decompressedBlocks.pop_front();
+	}
+}
+
+// the stream can only be decompressed in order, so a single thread works
+// ahead of the reader and queues the blocks
+void CompressedFile::runDecompressor() {
+	_mutex.lock();
+	while(!_bStopDecompressor) {
+		if(_bDecompressedEOF || _decompressedBlocks.size() >= COMPRESSED_BLOCKS_AHEAD) {
+			_blockTaken.wait(&_mutex);
+			continue;
+		}
+
+		_mutex.unlock();
+		DecompressedBlock* pBlock = new DecompressedBlock();
+		decompressBlock(pBlock);
+		_mutex.lock();
+
+		if(pBlock->bEOF || pBlock->bError) {
+			_bDecompressedEOF = true;
+		}
+		_decompressedBlocks.push_back(pBlock);
+		_blockDecompressed.wakeAll();
+	}
+	_mutex.unlock();
+}
+
+bool CompressedFile::takeDecompressedBlock() {
+	if(_bEOF) {
+		return false;
+	}
+
+	if(_pDecompressor == NULL) {
+		startDecompressor();
+	}
+
+	_mutex.lock();
+	while(_decompressedBlocks.empty()) {
+		_blockDecompressed.wait(&_mutex);
+	}
+
+	DecompressedBlock* pDecompressed = _decompressedBlocks.front();
+	_decompressedBlocks.pop_front();
+	_blockTaken.wakeAll();
+	_mutex.unlock();
+
+	_block.position = pDecompressed->position;
+	_block.length = pDecompressed->length;
+	_block.bEOF = pDecompressed->bEOF;
+	_block.bError = pDecompressed->bError;
+	_block.data.swap(pDecompressed->data);
+	delete pDecompressed;
+
+	if(_block.bEOF || _block.bError) {
+		_block.length = 0;
+		_bEOF = true;
+		return false;
+	}
+
+	return true;
+}
+
+// return the unread part of the current block without copying it
+// the data stays valid until the next call on this object
+bool CompressedFile::nextChunk(const char*& data, int& length, uint64_t& position) {
+	if(eof()) {
+		return false;
+	}
+
+	position = tell();
+	data = &_block.data[_blockOffset];
+	length = _block.length - _blockOffset;
+	_blockOffset = _block.length;
+	return true;
+}
+
+bool CompressedFile::eof() {
+	if(!openFile()) {
+		return true;
+	}
+
+	while(_blockOffset >= _block.length) {
+		if(_bEOF || !readBlock()) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint64_t CompressedFile::tell() {
+	return _block.position + _blockOffset;
+}
+
+// positions in the current block or after it are reached by reading on,
+// earlier positions by decompressing the file from the start again
+bool CompressedFile::seek(uint64_t position) {
+	if(!openFile()) {
+		return false;
+	}
+
+	if(position < _block.position) {
+		Logger::getLogger()->log(QSNP_INFO, "seeking back in compressed file, decompressing from the start: " + _filename);
+		if(!restart()) {
+			return false;
+		}
+	}
+
+	while(position > _block.position + _block.length) {
+		if(_bEOF || !readBlock()) {
+			Logger::getLogger()->log(QSNP_ERROR, "could not seek beyond the end of file: " + _filename);
+			return false;
+		}
+	}
+
+	_blockOffset = position - _block.position;
+	return true;
+}
+
+CompressedStreamBuf::CompressedStreamBuf(const string& filename, Compression compression, bool bBackground):
+  _compressedFile(filename, compression, bBackground), _chunkOffset(0)
+{
+	setg(NULL, NULL, NULL);
+}
+
+// hand out the rest of the current block as the get area
+CompressedStreamBuf::int_type CompressedStreamBuf::underflow() {
+	if(gptr() < egptr()) {
+		return traits_type::to_int_type(*gptr());
+	}
+
+	const char* data;
+	int length;
+	if(!_compressedFile.nextChunk(data, length, _chunkOffset)) {
+		return traits_type::eof();
+	}
+
+	char* pData = const_cast<char*>(data);
+	setg(pData, pData, pData + length);
+	return traits_type::to_int_type(*gptr());
+}
+
+CompressedStreamBuf::pos_type CompressedStreamBuf::seekoff(off_type offset, ios_base::seekdir direction, ios_base::openmode mode) {
+	if(offset == 0 && direction == ios_base::cur) {
+		// tellg, the get area never crosses a block boundary
+		if(gptr() == egptr()) {
+			return pos_type(off_type(_compressedFile.tell()));
+		}
+		return pos_type(off_type(_chunkOffset + (gptr() - eback())));
+	}
+
+	if(direction == ios_base::beg) {
+		return seekpos(pos_type(offset), mode);
+	}
+
+	// relative seeks are not supported in a compressed stream
+	return pos_type(off_type(-1));
+}
+
+CompressedStreamBuf::pos_type CompressedStreamBuf::seekpos(pos_type position, ios_base::openmode) {
+	setg(NULL, NULL, NULL);
+	if(!_compressedFile.seek(static_cast<uint64_t>(off_type(position)))) {
+		return pos_type(off_type(-1));
+	}
+
+	return position;
+}
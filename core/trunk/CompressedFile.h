@@ -0,0 +1,145 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __COMPRESSEDFILE_H__
+#define __COMPRESSEDFILE_H__
+
+#include <string>
+#include <fstream>
+#include <streambuf>
+#include <vector>
+#include <list>
+#include <stdint.h>
+#include <zlib.h>
+#include <QMutex>
+#include <QWaitCondition>
+#ifdef QSNP_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace std;
+
+// compression of an input file, recognized by its magic bytes
+enum Compression {
+	COMPRESSION_NONE,
+	COMPRESSION_BGZF,
+	COMPRESSION_GZIP,
+	COMPRESSION_ZSTD
+};
+
+class Decompressor;
+
+struct DecompressedBlock {
+	uint64_t		position;	// stream position of the first uncompressed byte
+	vector<char>	data;
+	int				length;
+	bool			bEOF;
+	bool			bError;
+};
+
+// reader for files that are compressed as a single stream, gzip (also with
+// several members, like concatenated .gz files) and zstd if the program is
+// built with QSNP_HAVE_ZSTD. Stream positions are offsets in the
+// uncompressed data, seeking back restarts decompression at the start.
+//
+// with bBackground the file is decompressed by a thread of its own, a few
+// blocks ahead of the reader
+class CompressedFile
+{
+public:
+	CompressedFile(const string& filename, Compression compression, bool bBackground = true);
+	~CompressedFile(void);
+
+	bool openFile();
+	bool nextChunk(const char*& data, int& length, uint64_t& position);
+	bool eof();
+	uint64_t tell();
+	bool seek(uint64_t position);
+
+	static Compression detectCompression(const string& filename);
+	static string compressionName(Compression compression);
+	static bool isSupported(Compression compression);
+
+private:
+	friend class Decompressor;
+
+	bool initStream();
+	void endStream();
+	bool restart();
+	bool readInput();
+	bool decompressBlock(DecompressedBlock* pBlock);
+	bool readBlock();
+	bool takeDecompressedBlock();
+	void startDecompressor();
+	void stopDecompressor();
+	void runDecompressor();
+
+private:
+	string						_filename;
+	Compression					_compression;
+	ifstream					_ifFile;
+	DecompressedBlock			_block;
+	int							_blockOffset;
+	bool						_bEOF;
+
+	// decompression state, only used by one thread at a time
+	z_stream					_zStream;
+#ifdef QSNP_HAVE_ZSTD
+	ZSTD_DStream*				_pZstdStream;
+#endif
+	bool						_bStreamOpen;
+	bool						_bStreamEnd;
+	vector<char>				_input;
+	size_t						_inputStart;
+	size_t						_inputEnd;
+	bool						_bInputEOF;
+	uint64_t					_nextPosition;
+
+	// background decompression
+	bool						_bBackground;
+	Decompressor*				_pDecompressor;
+	QMutex						_mutex;
+	QWaitCondition				_blockDecompressed;
+	QWaitCondition				_blockTaken;
+	list<DecompressedBlock*>	_decompressedBlocks;
+	bool						_bDecompressedEOF;
+	bool						_bStopDecompressor;
+};
+
+// exposes the uncompressed contents of a gzip or zstd file as a stream
+// buffer for the line based readers. Stream positions are offsets in the
+// uncompressed data.
+class CompressedStreamBuf : public streambuf
+{
+public:
+	CompressedStreamBuf(const string& filename, Compression compression, bool bBackground = true);
+	bool openFile() { return _compressedFile.openFile(); }
+
+protected:
+	int_type underflow();
+	pos_type seekoff(off_type offset, ios_base::seekdir direction, ios_base::openmode mode);
+	pos_type seekpos(pos_type position, ios_base::openmode mode);
+
+private:
+	CompressedFile	_compressedFile;
+	uint64_t		_chunkOffset;
+};
+
+#endif
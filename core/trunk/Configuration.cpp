@@ -52,9 +52,14 @@ Configuration::Configuration(void)
     intMap["minNumberOfHighQualityReads"]		= 2;
     intMap["logLevel"]							= QSNP_WARNING;
     intMap["minimalMappingQuality"]				= 0;
+    intMap["includeFlags"]                      = 0;
+    intMap["excludeFlags"]                      = 0xF04; // unmapped, secondary, QC fail, duplicate, supplementary
     intMap["maxNumberOfReads"]                  = 0;
     intMap["lowComplexityRegionSize"]           = 6;
     intMap["lowComplexityRepeatCount"]          = 5;
+    intMap["decompressionThreads"]              = 4;
+    intMap["parsingThreads"]                    = 0;
+    intMap["groupingMemory"]                    = 1024; // MB
     doubleMap["similarityPerPolymorphicSite"]	= 0.75;
     doubleMap["similarityAllPolymorphicSites"]	= 0.8;
     doubleMap["alleleMajorityThreshold"]		= 0.75;
@@ -69,6 +74,8 @@ Configuration::Configuration(void)
     stringMap["readGroupsFile"]                 = "readgroups.csv";
     stringMap["readNameGroupSeparator"]         = "";
     stringMap["configurationFile"]              = "";
+    stringMap["regionsFile"]                    = "";
+    stringMap["referenceFile"]                  = "";
 
     charMap["fieldSeparator"]					= '\t';
     boolMap["indelLowQuality"]					= true;
@@ -82,8 +89,10 @@ Configuration::Configuration(void)
     boolMap["onlyReliableMarkers"]				= true;
     boolMap["showContigsWithoutSNP"]			= true;
     boolMap["collectStatistics"]                = true;
+    boolMap["groupContigs"]                     = false;
     boolMap["outputReadGroups"]                 = true;
     boolMap["servermode"]                       = false;
+    boolMap["useContigIndex"]                   = true;
 
     nucMap = new int[256];
     for (int i = 0; i < 256; i++) {
@@ -26,37 +26,133 @@
 #include "Configuration.h"
 #include "HaploType.h"
 #include "ReadGroup.h"
+#include "Pileup.h"
+#include "ReadIntervalIndex.h"
+#include "ReadAlleles.h"
 #include "Contig.h"
 
 using namespace std;
 
 Contig::Contig(const string& name) :
-	_name(name), _cPotentialSNP(-1), _cHighConfidenceSNP(-1), _cReliableSNP(-1), _Dvalue(-1), _cReads(0)
+	_parameters(Configuration::getConfig()), _name(name), _pPileup(NULL), _pReadIntervalIndex(NULL), _pReadAlleles(NULL), _cPotentialSNP(-1), _cHighConfidenceSNP(-1), _cReliableSNP(-1), _Dvalue(-1), _cReads(0)
 {
 	Logger::getLogger()->log(QSNP_INFO, "New contig: " + _name);
-    _defaultQualityScore = Configuration::getConfig()->getInt("minSNPQualityScore");
+    _defaultQualityScore = _parameters.minSNPQualityScore;
 }
 
+Contig::Contig(const string& name, const RunParameters& parameters) :
+	_parameters(parameters), _name(name), _pPileup(NULL), _pReadIntervalIndex(NULL), _cPotentialSNP(-1), _cHighConfidenceSNP(-1), _cReliableSNP(-1), _Dvalue(-1), _cReads(0)
+{
+	Logger::getLogger()->log(QSNP_INFO, "New contig: " + _name);
+    _defaultQualityScore = _parameters.minSNPQualityScore;
+}
+
+// the objects are in the arena, which frees their memory at once after
+// they are destroyed
 Contig::~Contig(void) {
-	while (!_reads.empty()) {
-		delete static_cast<SeqRead*> (_reads.back());
-		_reads.pop_back();
+	for(list<SeqRead*>::iterator itReads = _reads.begin(); itReads != _reads.end(); itReads++) {
+		(*itReads)->~SeqRead();
 	}
 
-	while(!_variations.empty()) {
-		delete static_cast<Variation*> (_variations.back());
-		_variations.pop_back();
+	for(vector<Variation*>::iterator itVariations = _variations.begin(); itVariations != _variations.end(); itVariations++) {
+		(*itVariations)->~Variation();
 	}
 
-	while(!_haploTypes.empty()) {
-		delete static_cast<HaploType*> (_haploTypes.back());
-		_haploTypes.pop_back();
+	for(list<HaploType*>::iterator itHaploTypes = _haploTypes.begin(); itHaploTypes != _haploTypes.end(); itHaploTypes++) {
+		(*itHaploTypes)->~HaploType();
 	}
 
-    while(!_readGroups.empty()) {
-        delete static_cast<ReadGroup*> ((*_readGroups.begin()).second);
-        _readGroups.erase(_readGroups.begin());
+    for(map<string, ReadGroup*>::iterator itReadGroups = _readGroups.begin(); itReadGroups != _readGroups.end(); itReadGroups++) {
+        itReadGroups->second->~ReadGroup();
     }
+
+    delete _pPileup;
+    delete _pReadIntervalIndex;
+    delete _pReadAlleles;
+}
+
+// the pileup of the reads, built when it is first needed and again after
+// reads are added or the sequence changes
+Pileup* Contig::getPileup() {
+	if(_pPileup == NULL) {
+		_pPileup = new Pileup(getSequenceLength(), _parameters);
+		for(list<SeqRead*>::iterator itReads = _reads.begin(); itReads != _reads.end(); itReads++) {
+			_pPileup->addRead(*itReads);
+		}
+	}
+
+	return _pPileup;
+}
+
+void Contig::clearPileup() {
+	delete _pPileup;
+	_pPileup = NULL;
+}
+
+// the interval index of the reads, built when it is first needed and again
+// after reads are added or sorted
+ReadIntervalIndex* Contig::getReadIntervalIndex() {
+	if(_pReadIntervalIndex == NULL) {
+		_pReadIntervalIndex = new ReadIntervalIndex(_reads);
+	}
+
+	return _pReadIntervalIndex;
+}
+
+void Contig::clearReadIntervalIndex() {
+	delete _pReadIntervalIndex;
+	_pReadIntervalIndex = NULL;
+}
+
+// the reads that have a nucleotide at a position, in the order of the reads list
+vector<SeqRead*> Contig::readsOverlapping(int pos) {
+	return readsOverlapping(pos, pos);
+}
+
+// the reads that have a nucleotide in the range start..end, in the order of
+// the reads list
+vector<SeqRead*> Contig::readsOverlapping(int start, int end) {
+	ReadIntervalIndex* pIndex = getReadIntervalIndex();
+	vector<int> readIndices;
+	pIndex->findOverlapping(start, end, readIndices);
+
+	vector<SeqRead*> reads;
+	reads.reserve(readIndices.size());
+	for(vector<int>::iterator itIndices = readIndices.begin(); itIndices != readIndices.end(); itIndices++) {
+		reads.push_back(pIndex->getRead(*itIndices));
+	}
+
+	return reads;
+}
+
+// the alleles of the reads at the high confidence variations, built when
+// they are first needed and again after reads or variations are added
+ReadAlleles* Contig::getReadAlleles() {
+	if(_pReadAlleles == NULL) {
+		_pReadAlleles = new ReadAlleles(this);
+	}
+
+	return _pReadAlleles;
+}
+
+void Contig::clearReadAlleles() {
+	delete _pReadAlleles;
+	_pReadAlleles = NULL;
+}
+
+// the high and low quality nucleotide counts of the reads at a position
+void Contig::getQualityCounts(int pos, int* hqCounts, int* lqCounts) {
+	Pileup* pPileup = getPileup();
+	if(!pPileup->getQualityCounts(pos, hqCounts, lqCounts)) {
+		vector<SeqRead*> reads = readsOverlapping(pos);
+		pPileup->countColumns(list<SeqRead*>(reads.begin(), reads.end()), vector<int>(1, pos));
+		if(!pPileup->getQualityCounts(pos, hqCounts, lqCounts)) {
+			// outside the contig sequence
+			int nDifferentNucs = _parameters.cNucs;
+			fill(hqCounts, hqCounts + nDifferentNucs, 0);
+			fill(lqCounts, lqCounts + nDifferentNucs, 0);
+		}
+	}
 }
 
 HaploType* Contig::getHaploTypeForID(int id) {
@@ -108,8 +204,16 @@ void Contig::calculateProperties() {
 
 // set the sequence for this contig and make it upper case
 void Contig::setSequence(const string& sequence) {
+	string copy(sequence);
+	takeSequence(copy);
+}
+
+// take over the sequence without copying it, the argument is left empty
+void Contig::takeSequence(string& sequence) {
 	Logger::getLogger()->log(QSNP_INFO, "Contig::setSequence");
-	_sequence = sequence;
+	_sequence.swap(sequence);
+	string().swap(sequence);
+	clearPileup();
 
 	transform (_sequence.begin (), _sequence.end (), _sequence.begin (), (int(*)(int)) toupper);
 }
@@ -153,6 +257,23 @@ void Contig::setQuality(const string& quality) {
 	}
 }
 
+// set the decoded qualities for the unpadded nucleotides in this contig
+void Contig::setQuality(const vector<int>& quality) {
+	Logger::getLogger()->log(QSNP_INFO, "Contig::setQuality");
+	_quality.reserve(_sequence.length());
+	unsigned int count = 0;
+	vector<int>::const_iterator itQuality;
+	for(itQuality = quality.begin(); itQuality != quality.end(); itQuality++) {
+		while(getSequenceAt(count) == '*') {
+			_quality.push_back(-1);
+			count++;
+		}
+
+		_quality.push_back(*itQuality);
+		count++;
+	}
+}
+
 // add a read to this contig, check that it does not conflict with an already present one
 bool Contig::addRead(SeqRead* pRead) {
 	Logger::getLogger()->log(QSNP_DEBUG, string("Adding read: ") + pRead->getName());
@@ -163,6 +284,9 @@ bool Contig::addRead(SeqRead* pRead) {
 
 	_reads.push_back(pRead);
 	_cReads++;
+	clearPileup();
+	clearReadIntervalIndex();
+	clearReadAlleles();
 	_readMap[pRead->getName()] = pRead;
 
 	return true;
@@ -198,6 +322,7 @@ void Contig::addHaploType(HaploType* pHaploType) {
 
 void Contig::addVariation(Variation* pVariation) {
     _variations.push_back(pVariation);
+    clearReadAlleles();
 }
 
 // return the number of potential SNPs, i.e. before quality filtering
@@ -250,57 +375,24 @@ int Contig::getReliableSNPCount() {
 
 void Contig::determineVariations() {
 	Logger::getLogger()->log(QSNP_INFO, "Contig::determineVariations");
-	Configuration* pConfig = Configuration::getConfig();
-	int nDifferentNucs = pConfig->getNumberOfNucs();
-	int nMinAlleles = pConfig->getInt("minimalNumberOfReadsPerAllele");
-	double dMinAllelesp = pConfig->getDouble("minimalNumberOfReadsPerAllelep");
+	int nDifferentNucs = _parameters.cNucs;
+	int nMinAlleles = _parameters.minimalNumberOfReadsPerAllele;
+	double dMinAllelesp = _parameters.minimalNumberOfReadsPerAllelep;
 	
-    vector<list<SeqRead*> > startPositions;
-    startPositions.resize(getSequenceLength());
-    list<SeqRead*>::iterator itReads;
-    for (itReads=_reads.begin(); itReads != _reads.end(); itReads++) {
-        int startPosition = (*itReads)->getStartPosition();
-        if(startPosition < 0) {
-            startPosition = 0;
-        }
-        startPositions[startPosition].push_back(*itReads);
-    }
-
-    list<SeqRead*> reads;
-	for (int iSeq = 0; iSeq < (int)_sequence.length(); iSeq++) {
-        while(!startPositions[iSeq].empty()) {
-            reads.push_back(startPositions[iSeq].front());
-            startPositions[iSeq].pop_front();
-        }
-
-		int* nucCount = new int[nDifferentNucs];
-		for(int iNuc= 0; iNuc < nDifferentNucs; iNuc++) {
-			nucCount[iNuc] = 0;
-		}
-
+    // find the columns with more than one allele in the pileup
+    Pileup* pPileup = getPileup();
+    vector<int> columns;
+	for (int iSeq = 0; iSeq < pPileup->getColumnCount(); iSeq++) {
 		int cInformativeReads = 0;
-		for (itReads=reads.begin(); itReads != reads.end();) {
-            if((*itReads)->getEndPosition() < iSeq) {
-                itReads = reads.erase(itReads);
-            } else {
-                char nuc = (*itReads)->getNucleotideAt(iSeq);
-                int nNuc = pConfig->nuc2int(nuc);
-                if (nNuc != -1) {
-                    cInformativeReads++;
-                    nucCount[nNuc]++;
-                } else {
-                    // TODO: handle unknown nucleotides...
-                    //Logger::getLogger()->log(QSNP_ERROR, "Found unknown nucleotide: " + nuc);
-                }
-                itReads++;
-			}
+		for(int iNuc= 0; iNuc < nDifferentNucs; iNuc++) {
+			cInformativeReads += pPileup->getCount(iSeq, iNuc);
 		}
 
 		int cNuc = 0;
 		int tmpMinAllelesp = static_cast<int>(cInformativeReads * dMinAllelesp) + 1;
 		int tmpMinAlleles = (nMinAlleles > tmpMinAllelesp) ? nMinAlleles : tmpMinAllelesp;
 		for ( int iNuc = 0; iNuc < nDifferentNucs; iNuc++) {
-			if(nucCount[iNuc] < tmpMinAlleles) {
+			if(pPileup->getCount(iSeq, iNuc) < tmpMinAlleles) {
 				// no valid SNP
 			} else {
 				cNuc++;
@@ -308,14 +400,23 @@ void Contig::determineVariations() {
 		}
 
 		if (cNuc > 1) {
-			Variation* var = new Variation(this, iSeq);
-			var->setNucCount(nucCount);
-			_variations.push_back(var);
-		} else {
-			delete [] nucCount;
+			columns.push_back(iSeq);
 		}
 	}
 
+	// the variations take their quality counts from the pileup
+	pPileup->countColumns(_reads, columns);
+	vector<int> nucCount(nDifferentNucs);
+	for (vector<int>::iterator itColumns = columns.begin(); itColumns != columns.end(); itColumns++) {
+		for(int iNuc= 0; iNuc < nDifferentNucs; iNuc++) {
+			nucCount[iNuc] = pPileup->getCount(*itColumns, iNuc);
+		}
+
+		Variation* var = new (this) Variation(this, *itColumns);
+		var->setNucCount(&nucCount[0]);
+		_variations.push_back(var);
+	}
+
 	_cPotentialSNP = _variations.size();
 }
 
@@ -386,7 +487,7 @@ void Contig::determineHaploTypes() {
 
 	while (!reads.empty()) {
 		cHaplo++;
-		HaploType* pHaploType = new HaploType(this, cHaplo);
+		HaploType* pHaploType = new (this) HaploType(this, cHaplo);
 		_haploTypes.push_back(pHaploType);
 
 		bool bReadAdded = true;
@@ -408,13 +509,13 @@ void Contig::determineHaploTypes() {
 
     // remove haplotypes that do not have enough reads
     list<HaploType*>::iterator itHaploTypes = _haploTypes.begin();
-    int minimalNumberOfReadsPerHaploType = Configuration::getConfig()->getInt("minimalNumberOfReadsPerHaploType");
+    int minimalNumberOfReadsPerHaploType = _parameters.minimalNumberOfReadsPerHaploType;
     int id = 0;
     Logger::getLogger()->log(QSNP_INFO, "Removing haplotypes that contain too little reads");
     while(itHaploTypes != _haploTypes.end()) {
         if ((*itHaploTypes)->getReadCount() < minimalNumberOfReadsPerHaploType) {
             list<SeqRead*> reads = (*itHaploTypes)->getReads();
-            delete (*itHaploTypes);
+            (*itHaploTypes)->~HaploType();
             itHaploTypes = _haploTypes.erase(itHaploTypes);
 
             // try to add the reads to one of the remaining haplotypes
@@ -456,6 +557,7 @@ bool readSortFunction(SeqRead* s1, SeqRead* s2) {
 // sort the reads according to their startpositions
 void Contig::sortReads() {
 	_reads.sort(readSortFunction);
+	clearReadIntervalIndex();
 }
 
 // calculate the D-Value for this contig
@@ -510,10 +612,16 @@ int Contig::findMarkerSNPs() {
 	Logger::getLogger()->log(QSNP_INFO, "findMarkerSNPs");
 
 	int cMarkerSNP = 0;
-	unsigned int nAllowedSNPs = Configuration::getConfig()->getInt("maxNumberOfSNPsInFlanks");
-	bool bOnlyReliableMarkers = Configuration::getConfig()->getBool("onlyReliableMarkers");
+	unsigned int nAllowedSNPs = _parameters.maxNumberOfSNPsInFlanks;
+	bool bOnlyReliableMarkers = _parameters.onlyReliableMarkers;
+
+	vector<int> previousLowQuality;
+	vector<int> nextLowQuality;
+	findLowQualityColumns(previousLowQuality, nextLowQuality);
 
-	stringstream result;
+	// the flank stops at the border or at the first low quality column on
+	// either side of the variation
+	int length = getSequenceLength();
 	for (unsigned int iVar = 0; iVar < _variations.size(); iVar++) {
 		if ((bOnlyReliableMarkers == false && _variations[iVar]->isHighConfidence()) 
 			|| _variations[iVar]->isReliable()) {
@@ -522,43 +630,52 @@ int Contig::findMarkerSNPs() {
 				_variations[iVar - (nAllowedSNPs + 1)]->getPos() : -1;
 			int rightBorder = ((iVar + nAllowedSNPs + 1) < _variations.size()) ? 
 				_variations[iVar + (nAllowedSNPs + 1)]->getPos() : _sequence.length();
-			int flankLength = 0;
-			bool bFlankGood = true;
 
-			while(bFlankGood) {
-				++flankLength;
-				bFlankGood = varPos - flankLength > leftBorder && varPos + flankLength < rightBorder && 
-					isHighQuality(varPos + flankLength) && isHighQuality(varPos - flankLength);
-			}
+			int flankLength = min(varPos - leftBorder, rightBorder - varPos) - 1;
+			flankLength = min(flankLength, (varPos > 0 && varPos <= length) ? varPos - 1 - previousLowQuality[varPos - 1] : 0);
+			flankLength = min(flankLength, (varPos >= 0 && varPos + 1 < length) ? nextLowQuality[varPos + 1] - varPos - 1 : 0);
 
 			cMarkerSNP++;
-			_variations[iVar]->setFlankLength(flankLength - 1); //always read one position too far
+			_variations[iVar]->setFlankLength(max(0, flankLength));
 		}
 	}
 
 	return cMarkerSNP;
 }
 
+// for every column the nearest column at or before it, and at or after it,
+// that is not high quality. -1 and the sequence length mark the ends.
+void Contig::findLowQualityColumns(vector<int>& previousLowQuality, vector<int>& nextLowQuality) {
+	int length = getSequenceLength();
+	previousLowQuality.resize(length);
+	nextLowQuality.resize(length);
+
+	int lowQualityColumn = -1;
+	for(int pos = 0; pos < length; pos++) {
+		if(!isHighQuality(pos)) {
+			lowQualityColumn = pos;
+		}
+		previousLowQuality[pos] = lowQualityColumn;
+	}
+
+	lowQualityColumn = length;
+	for(int pos = length - 1; pos >= 0; pos--) {
+		if(previousLowQuality[pos] == pos) {
+			lowQualityColumn = pos;
+		}
+		nextLowQuality[pos] = lowQualityColumn;
+	}
+}
+
 // check the quality at a position. False if the quality score is below threshold
 // or the number of high quality reads is less than the set minimum
 bool Contig::isHighQuality(unsigned int pos) {
-	Configuration* pConfig = Configuration::getConfig();
-	if(getQualityAt(pos) < pConfig->getInt("minSNPQualityScore")) {
+	if(getQualityAt(pos) < _parameters.minSNPQualityScore || pos >= static_cast<unsigned int>(getSequenceLength())) {
 		return false;
 	}
 
-	int cHQreads = 0;
-	list<SeqRead*>::iterator itReads;
-	for ( itReads=_reads.begin(); itReads != _reads.end(); itReads++) {
-		if((*itReads)->isHighQuality(pos)) {
-			cHQreads++;
-			if (cHQreads == pConfig->getInt("minNumberOfHighQualityReads")) {
-				return true;
-			}
-		}
-	}
-
-	return false;
+	int minHQReads = _parameters.minNumberOfHighQualityReads;
+	return minHQReads > 0 && getPileup()->getHighQualityReadCount(pos) >= minHQReads;
 }
 
 string Contig::reads2CSV() {
@@ -622,7 +739,7 @@ int Contig::maskHomopolymericTracts(int limit) {
 	char nuc = ' ';
 	int cHpt = 0;
 
-	int minSNPQuality = Configuration::getConfig()->getInt("minSNPQualityScore");
+	int minSNPQuality = _parameters.minSNPQualityScore;
 	for(unsigned int i=0;i<_sequence.length();i++) {
 		if(_sequence[i] == nuc) {
 			cNuc++;
@@ -683,7 +800,7 @@ void Contig::makeReadGroups()
 
     map<string, list<SeqRead*> >::iterator itRG;
     for(itRG = readGroups.begin(); itRG != readGroups.end(); itRG++) {
-        ReadGroup* rg = new ReadGroup(itRG->first, this);
+        ReadGroup* rg = new (this) ReadGroup(itRG->first, this);
         rg->addReads(itRG->second);
         _readGroups[itRG->first] = rg;
     }
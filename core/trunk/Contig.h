@@ -26,6 +26,8 @@
 #include <string>
 #include <map>
 #include "Logger.h"
+#include "ContigArena.h"
+#include "RunParameters.h"
 
 using namespace std;
 
@@ -33,11 +35,15 @@ class Variation;
 class HaploType;
 class SeqRead;
 class ReadGroup;
+class Pileup;
+class ReadIntervalIndex;
+class ReadAlleles;
 
 class Contig
 {
 public:
 	Contig(const string&);
+	Contig(const string&, const RunParameters&);
 	~Contig(void);
 
 	//getters/setters
@@ -46,9 +52,18 @@ public:
 	const list<HaploType*>& getHaploTypes() { return _haploTypes; }
 	const string& getName() { return _name; }
 	const string& getSequence() {	return _sequence;	}
+	ContigArena& getArena() { return _arena; }
+	const RunParameters& getParameters() { return _parameters; }
+	Pileup* getPileup();
+	ReadAlleles* getReadAlleles();
+	void getQualityCounts(int pos, int* hqCounts, int* lqCounts);
+	vector<SeqRead*> readsOverlapping(int pos);
+	vector<SeqRead*> readsOverlapping(int start, int end);
 	double getDvalue();
 	void setSequence(const string&);
+	void takeSequence(string&);
 	void setQuality(const string&);
+	void setQuality(const vector<int>&);
 	bool setQualityAt(unsigned int pos, int quality);
 	char getSequenceAt(unsigned int);
 	int getQualityAt(unsigned int);
@@ -83,18 +98,28 @@ public:
 
 private:
 	void determineVariations();
+	void clearPileup();
+	ReadIntervalIndex* getReadIntervalIndex();
+	void clearReadIntervalIndex();
+	void clearReadAlleles();
     void determineHaploTypes();
     bool addReadToHaploType(SeqRead*);
 	void calculateSNPCountPerRead();
 	bool isHighQuality(unsigned int pos);
+	void findLowQualityColumns(vector<int>& previousLowQuality, vector<int>& nextLowQuality);
     void determineReliableSNPs();
     void setReadGroupNames();
     void makeReadGroups();
 
+	ContigArena				_arena;	// the reads, variations, haplotypes and read groups
+	const RunParameters		_parameters;
 	const string			_name;
 	string					_sequence;
 	map<string, SeqRead*>	_readMap;
 	list<SeqRead*>			_reads;
+	Pileup*					_pPileup;
+	ReadIntervalIndex*		_pReadIntervalIndex;
+	ReadAlleles*			_pReadAlleles;
     map<string, ReadGroup*> _readGroups;
     //list<ReadGroup*>        _readGroups;
 	double					_Dvalue;
@@ -0,0 +1,123 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <new>
+#include <QMutex>
+#include <QMutexLocker>
+#include "ContigArena.h"
+
+using namespace std;
+
+// size of the blocks in the pool
+static const size_t ARENA_BLOCK_SIZE = 256 * 1024;
+
+// allocations are aligned for any of the objects in the arena
+static const size_t ARENA_ALIGNMENT = 16;
+
+// allocations larger than this get a block of their own
+static const size_t ARENA_LARGE_SIZE = ARENA_BLOCK_SIZE / 4;
+
+// free blocks kept for the next contigs, beyond that they are freed
+static const size_t ARENA_POOL_SIZE = 256;
+
+static QMutex arenaPoolMutex;
+static vector<char*> arenaPool;
+
+ContigArena::ContigArena(void): _pFree(NULL), _cFree(0)
+{
+}
+
+ContigArena::~ContigArena(void)
+{
+	reset();
+}
+
+void* ContigArena::allocate(size_t size) {
+	size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+	if(size == 0) {
+		size = ARENA_ALIGNMENT;
+	}
+
+	if(size > ARENA_LARGE_SIZE) {
+		char* pLarge = static_cast<char*>(malloc(size));
+		if(pLarge == NULL) {
+			throw bad_alloc();
+		}
+		_largeBlocks.push_back(pLarge);
+		return pLarge;
+	}
+
+	if(size > _cFree) {
+		nextBlock();
+	}
+
+	void* pMemory = _pFree;
+	_pFree += size;
+	_cFree -= size;
+	return pMemory;
+}
+
+void ContigArena::nextBlock() {
+	char* pBlock = NULL;
+	{
+		QMutexLocker locker(&arenaPoolMutex);
+		if(!arenaPool.empty()) {
+			pBlock = arenaPool.back();
+			arenaPool.pop_back();
+		}
+	}
+
+	if(pBlock == NULL) {
+		pBlock = static_cast<char*>(malloc(ARENA_BLOCK_SIZE));
+		if(pBlock == NULL) {
+			throw bad_alloc();
+		}
+	}
+
+	_blocks.push_back(pBlock);
+	_pFree = pBlock;
+	_cFree = ARENA_BLOCK_SIZE;
+}
+
+// release all allocations at once, the objects in the arena have to be
+// destroyed before
+void ContigArena::reset() {
+	for(vector<char*>::iterator itLarge = _largeBlocks.begin(); itLarge != _largeBlocks.end(); itLarge++) {
+		free(*itLarge);
+	}
+	_largeBlocks.clear();
+
+	if(!_blocks.empty()) {
+		QMutexLocker locker(&arenaPoolMutex);
+		vector<char*>::iterator itBlocks;
+		for(itBlocks = _blocks.begin(); itBlocks != _blocks.end(); itBlocks++) {
+			if(arenaPool.size() < ARENA_POOL_SIZE) {
+				arenaPool.push_back(*itBlocks);
+			} else {
+				free(*itBlocks);
+			}
+		}
+		_blocks.clear();
+	}
+
+	_pFree = NULL;
+	_cFree = 0;
+}
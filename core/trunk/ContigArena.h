@@ -0,0 +1,61 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CONTIGARENA_H__
+#define __CONTIGARENA_H__
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+// monotonic allocator for the analysis objects of a contig: the reads,
+// variations, haplotypes and read groups and their arrays. Memory is taken
+// from large blocks and only given back all at once, when the arena is reset
+// or destroyed. The objects are created with the placement new of their class,
+// e.g. new (pContig) SeqRead(name, pContig), and their destructors are called
+// by the contig.
+//
+// The blocks go back to a pool shared by all arenas, so the next contig
+// reuses them instead of asking malloc again.
+class ContigArena
+{
+public:
+	ContigArena(void);
+	~ContigArena(void);
+
+	void* allocate(size_t size);
+	template <class T> T* allocateArray(size_t count) { return static_cast<T*>(allocate(count * sizeof(T))); }
+	void reset();
+
+private:
+	ContigArena(const ContigArena&);
+	ContigArena& operator=(const ContigArena&);
+
+	void nextBlock();
+
+private:
+	vector<char*>	_blocks;		// pool blocks in use, the last one is filled
+	vector<char*>	_largeBlocks;	// allocations that do not fit a pool block
+	char*			_pFree;
+	size_t			_cFree;
+};
+
+#endif
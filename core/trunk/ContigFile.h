@@ -21,10 +21,19 @@
 #ifndef __CONTIGFILE_H__
 #define __CONTIGFILE_H__
 
+class RegionList;
+class ReferenceFile;
+
 class ContigFile
 {
 public:
 	virtual Contig* nextContig() = 0;
+	virtual Contig* getContig(const string& name) = 0;
+	virtual vector<Contig*> getContigs(const vector<string>& names);
+	// only read the reads overlapping the regions, if the format allows it
+	virtual void setRegions(RegionList* /*pRegions*/) {}
+	// take the contig sequences from a reference, if the format has no sequence of its own
+	virtual void setReference(ReferenceFile* /*pReference*/) {}
 	virtual bool isValid() = 0;
 	virtual ~ContigFile() {}
     virtual int contigCount() = 0;
@@ -32,4 +41,18 @@ public:
     virtual vector<string>& readGroups() = 0;
 };
 
+// fetch the contigs in the order of the names, unknown names are skipped
+inline vector<Contig*> ContigFile::getContigs(const vector<string>& names) {
+	vector<Contig*> contigs;
+	vector<string>::const_iterator itNames;
+	for(itNames = names.begin(); itNames != names.end(); itNames++) {
+		Contig* pContig = getContig(*itNames);
+		if(pContig != NULL) {
+			contigs.push_back(pContig);
+		}
+	}
+
+	return contigs;
+}
+
 #endif
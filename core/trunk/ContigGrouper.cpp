@@ -0,0 +1,145 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include "Logger.h"
+#include "ContigGrouper.h"
+
+using namespace std;
+
+ContigGrouper::ContigGrouper(const string& spillPrefix, uint64_t memoryBudget): _spillPrefix(spillPrefix),
+  _memoryBudget(memoryBudget), _cBufferedBytes(0), _iNextGroup(0), _iLastGroup(-1)
+{
+}
+
+ContigGrouper::~ContigGrouper(void)
+{
+	vector<string>::iterator itFilenames;
+	for(itFilenames = _spillFilenames.begin(); itFilenames != _spillFilenames.end(); itFilenames++) {
+		remove(itFilenames->c_str());
+	}
+}
+
+// add an alignment line to the group of its contig, the line end is added
+bool ContigGrouper::addLine(const char* contigName, int nameLength, const char* line, int length) {
+	if(_iLastGroup == -1 || _lastContigName.compare(0, string::npos, contigName, nameLength) != 0) {
+		_lastContigName.assign(contigName, nameLength);
+		map<string, int>::iterator itGroup = _groupMap.find(_lastContigName);
+		if(itGroup == _groupMap.end()) {
+			_iLastGroup = _groups.size();
+			_groupMap[_lastContigName] = _iLastGroup;
+			_groups.push_back(ContigGroup());
+			_groups.back().name = _lastContigName;
+		} else {
+			_iLastGroup = itGroup->second;
+		}
+	}
+
+	string& lines = _groups[_iLastGroup].lines;
+	lines.append(line, length);
+	lines.push_back('\n');
+	_cBufferedBytes += length + 1;
+
+	if(_cBufferedBytes > _memoryBudget) {
+		return spill();
+	}
+
+	return true;
+}
+
+// write the buffered lines of all contigs to a new spill file
+bool ContigGrouper::spill() {
+	stringstream ssFilename;
+	ssFilename << _spillPrefix << "." << _spillFilenames.size() << ".spill";
+	string filename = ssFilename.str();
+
+	ofstream ofSpill(filename.c_str(), ios::out | ios::binary | ios::trunc);
+	if(!ofSpill) {
+		Logger::getLogger()->log(QSNP_ERROR, "could not create spill file: " + filename);
+		return false;
+	}
+	_spillFilenames.push_back(filename);
+	Logger::getLogger()->log(QSNP_INFO, "writing spill file: " + filename);
+
+	uint64_t offset = 0;
+	vector<ContigGroup>::iterator itGroups;
+	for(itGroups = _groups.begin(); itGroups != _groups.end(); itGroups++) {
+		if(itGroups->lines.empty()) {
+			continue;
+		}
+
+		SpillSegment segment;
+		segment.iSpillFile = _spillFilenames.size() - 1;
+		segment.offset = offset;
+		segment.length = itGroups->lines.size();
+		itGroups->segments.push_back(segment);
+
+		ofSpill.write(itGroups->lines.data(), itGroups->lines.size());
+		offset += itGroups->lines.size();
+
+		// give the memory back
+		string().swap(itGroups->lines);
+	}
+
+	_cBufferedBytes = 0;
+	if(!ofSpill.flush()) {
+		Logger::getLogger()->log(QSNP_ERROR, "could not write spill file: " + filename);
+		return false;
+	}
+
+	return true;
+}
+
+// the lines of the next contig, returns false after the last contig
+bool ContigGrouper::nextGroup(string& contigName, string& lines) {
+	if(_iNextGroup >= _groups.size()) {
+		return false;
+	}
+
+	ContigGroup& group = _groups[_iNextGroup++];
+	contigName = group.name;
+
+	uint64_t cBytes = group.lines.size();
+	vector<SpillSegment>::iterator itSegments;
+	for(itSegments = group.segments.begin(); itSegments != group.segments.end(); itSegments++) {
+		cBytes += itSegments->length;
+	}
+
+	lines.clear();
+	lines.reserve(cBytes);
+	for(itSegments = group.segments.begin(); itSegments != group.segments.end(); itSegments++) {
+		const string& filename = _spillFilenames[itSegments->iSpillFile];
+		ifstream ifSpill(filename.c_str(), ios::in | ios::binary);
+		ifSpill.seekg(streamoff(itSegments->offset), ios::beg);
+
+		size_t start = lines.size();
+		lines.resize(start + itSegments->length);
+		if(!ifSpill.read(&lines[start], itSegments->length)) {
+			Logger::getLogger()->log(QSNP_ERROR, "could not read spill file: " + filename);
+			return false;
+		}
+	}
+
+	lines.append(group.lines);
+	string().swap(group.lines);
+	return true;
+}
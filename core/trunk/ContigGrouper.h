@@ -0,0 +1,76 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CONTIGGROUPER_H__
+#define __CONTIGGROUPER_H__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+using namespace std;
+
+// a piece of the lines of a contig in a spill file
+struct SpillSegment {
+	int			iSpillFile;
+	uint64_t	offset;
+	uint64_t	length;
+};
+
+struct ContigGroup {
+	string					name;
+	string					lines;		// lines that are not spilled yet
+	vector<SpillSegment>	segments;
+};
+
+// collects the lines of an unsorted alignment file per contig. The lines are
+// kept in memory up to the memory budget, then all of them are written to a
+// new spill file with the lines of every contig together. The contigs are
+// replayed in the order they were first seen, every one complete with its
+// lines in input order. The spill files are removed by the destructor.
+class ContigGrouper
+{
+public:
+	ContigGrouper(const string& spillPrefix, uint64_t memoryBudget);
+	~ContigGrouper(void);
+
+	bool addLine(const char* contigName, int nameLength, const char* line, int length);
+	bool nextGroup(string& contigName, string& lines);
+	int getSpillCount()		{ return _spillFilenames.size(); }
+
+private:
+	bool spill();
+
+private:
+	string					_spillPrefix;
+	uint64_t				_memoryBudget;
+	uint64_t				_cBufferedBytes;
+	vector<ContigGroup>		_groups;
+	map<string, int>		_groupMap;
+	vector<string>			_spillFilenames;
+	size_t					_iNextGroup;
+
+	// group of the previous line, unsorted input still has runs of a contig
+	string					_lastContigName;
+	int						_iLastGroup;
+};
+
+#endif
@@ -0,0 +1,308 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <fstream>
+#include <cstring>
+#include <sys/stat.h>
+#include "Configuration.h"
+#include "Logger.h"
+#include "ContigIndex.h"
+
+using namespace std;
+
+static const char* CONTIG_INDEX_MAGIC = "QSI\1";
+static const char* CONTIG_INDEX_EXTENSION = ".qsi";
+static const int32_t CONTIG_INDEX_VERSION = 3;
+
+template <class T>
+static void writeValue(ofstream& os, T value) {
+	os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void writeString(ofstream& os, const string& value) {
+	writeValue<int32_t>(os, value.size());
+	os.write(value.data(), value.size());
+}
+
+template <class T>
+static bool readValue(ifstream& is, T& value) {
+	return is.read(reinterpret_cast<char*>(&value), sizeof(T)).good();
+}
+
+static bool readString(ifstream& is, string& value) {
+	int32_t length;
+	if(!readValue(is, length) || length < 0) {
+		return false;
+	}
+	value.resize(length);
+	return length == 0 || is.read(&value[0], length).good();
+}
+
+ContigIndex::ContigIndex(const string& contigFilename): _contigFilename(contigFilename), _bLoaded(false)
+{
+}
+
+ContigIndex::~ContigIndex(void)
+{
+}
+
+void ContigIndex::clear() {
+	_contigs.clear();
+	_contigMap.clear();
+	_readGroups.clear();
+	_readGroupMap.clear();
+	_bLoaded = false;
+}
+
+ContigIndexEntry& ContigIndex::addContig(const string& name, uint64_t offset) {
+	ContigIndexEntry entry;
+	entry.name = name;
+	entry.offset = offset;
+	entry.size = 0;
+	entry.readCount = 0;
+	entry.length = 0;
+
+	if(_contigMap.count(name) == 0) {
+		_contigMap[name] = _contigs.size();
+	}
+	_contigs.push_back(entry);
+	return _contigs.back();
+}
+
+void ContigIndex::addRead(ContigIndexEntry& contig, const string& group) {
+	contig.readCount++;
+	if(group.empty()) {
+		return;
+	}
+
+	map<string, int>::iterator itGroup = _readGroupMap.find(group);
+	int iGroup;
+	if(itGroup == _readGroupMap.end()) {
+		iGroup = _readGroups.size();
+		_readGroupMap[group] = iGroup;
+		_readGroups.push_back(group);
+	} else {
+		iGroup = itGroup->second;
+	}
+
+	// reads of a group usually come together, so only check the last one
+	if(contig.readGroups.empty() || contig.readGroups.back() != iGroup) {
+		vector<int>::iterator itContigGroup = contig.readGroups.begin();
+		while(itContigGroup != contig.readGroups.end() && *itContigGroup != iGroup) {
+			itContigGroup++;
+		}
+		if(itContigGroup == contig.readGroups.end()) {
+			contig.readGroups.push_back(iGroup);
+		}
+	}
+}
+
+const ContigIndexEntry* ContigIndex::findContig(const string& name) {
+	map<string, int>::iterator itContig = _contigMap.find(name);
+	if(itContig == _contigMap.end()) {
+		return NULL;
+	}
+
+	return &_contigs[itContig->second];
+}
+
+int ContigIndex::getReadCount() {
+	int cReads = 0;
+	vector<ContigIndexEntry>::iterator itContigs;
+	for(itContigs = _contigs.begin(); itContigs != _contigs.end(); itContigs++) {
+		cReads += itContigs->readCount;
+	}
+
+	return cReads;
+}
+
+bool ContigIndex::statContigFile(int64_t& size, int64_t& modificationTime) {
+	struct stat fileStat;
+	if(stat(_contigFilename.c_str(), &fileStat) != 0) {
+		return false;
+	}
+
+	size = fileStat.st_size;
+	modificationTime = fileStat.st_mtime;
+	return true;
+}
+
+// the read groups of ACE files are taken from the read names, so the
+// index is only valid for the separator it was made with
+string ContigIndex::groupSeparator() {
+	return Configuration::getConfig()->getString("readNameGroupSeparator");
+}
+
+// load the index next to the contig file, or else the one in the output directory
+bool ContigIndex::load() {
+	clear();
+
+	if(!Configuration::getConfig()->getBool("useContigIndex")) {
+		return false;
+	}
+
+	string outputIndexFilename = Configuration::getConfig()->getString("outputDirectory") + "/"
+		+ _contigFilename.substr(_contigFilename.find_last_of("/\\") + 1) + CONTIG_INDEX_EXTENSION;
+
+	_bLoaded = loadFile(_contigFilename + CONTIG_INDEX_EXTENSION) || loadFile(outputIndexFilename);
+	if(!_bLoaded) {
+		clear();
+	}
+
+	return _bLoaded;
+}
+
+bool ContigIndex::loadFile(const string& indexFilename) {
+	ifstream ifIndex(indexFilename.c_str(), ios::in | ios::binary);
+	if(ifIndex.fail()) {
+		return false;
+	}
+
+	char magic[4];
+	int32_t version;
+	int64_t size, modificationTime, contigSize, contigModificationTime;
+	string separator;
+	if(!ifIndex.read(magic, 4) || memcmp(magic, CONTIG_INDEX_MAGIC, 4) != 0 || !readValue(ifIndex, version)
+			|| version != CONTIG_INDEX_VERSION || !readValue(ifIndex, size) || !readValue(ifIndex, modificationTime)
+			|| !readString(ifIndex, separator)) {
+		Logger::getLogger()->log(QSNP_WARNING, "ignoring invalid contig index: " + indexFilename);
+		return false;
+	}
+
+	if(!statContigFile(contigSize, contigModificationTime) || size != contigSize
+			|| modificationTime != contigModificationTime || separator != groupSeparator()) {
+		Logger::getLogger()->log(QSNP_INFO, "contig index is out of date: " + indexFilename);
+		return false;
+	}
+
+	clear();
+
+	int32_t cReadGroups;
+	if(!readValue(ifIndex, cReadGroups)) {
+		return false;
+	}
+	for(int iGroup = 0; iGroup < cReadGroups; iGroup++) {
+		string group;
+		if(!readString(ifIndex, group)) {
+			return false;
+		}
+		_readGroupMap[group] = _readGroups.size();
+		_readGroups.push_back(group);
+	}
+
+	int32_t cContigs;
+	if(!readValue(ifIndex, cContigs) || cContigs < 0) {
+		return false;
+	}
+	_contigs.reserve(cContigs);
+	for(int iContig = 0; iContig < cContigs; iContig++) {
+		string name;
+		uint64_t offset, size;
+		int32_t readCount, length, cContigGroups;
+		if(!readString(ifIndex, name) || !readValue(ifIndex, offset) || !readValue(ifIndex, size)
+				|| !readValue(ifIndex, readCount)
+				|| !readValue(ifIndex, length) || !readValue(ifIndex, cContigGroups)) {
+			Logger::getLogger()->log(QSNP_WARNING, "ignoring truncated contig index: " + indexFilename);
+			return false;
+		}
+
+		ContigIndexEntry& entry = addContig(name, offset);
+		entry.size = size;
+		entry.readCount = readCount;
+		entry.length = length;
+		for(int iGroup = 0; iGroup < cContigGroups; iGroup++) {
+			int32_t group;
+			if(!readValue(ifIndex, group) || group < 0 || group >= cReadGroups) {
+				Logger::getLogger()->log(QSNP_WARNING, "ignoring truncated contig index: " + indexFilename);
+				return false;
+			}
+			entry.readGroups.push_back(group);
+		}
+	}
+
+	Logger::getLogger()->log(QSNP_INFO, "using contig index: " + indexFilename);
+	return true;
+}
+
+// save the index next to the contig file, or else in the output directory
+bool ContigIndex::save() {
+	if(!Configuration::getConfig()->getBool("useContigIndex")) {
+		return false;
+	}
+
+	string outputIndexFilename = Configuration::getConfig()->getString("outputDirectory") + "/"
+		+ _contigFilename.substr(_contigFilename.find_last_of("/\\") + 1) + CONTIG_INDEX_EXTENSION;
+
+	if(saveFile(_contigFilename + CONTIG_INDEX_EXTENSION) || saveFile(outputIndexFilename)) {
+		return true;
+	}
+
+	Logger::getLogger()->log(QSNP_WARNING, "could not write contig index for: " + _contigFilename);
+	return false;
+}
+
+bool ContigIndex::saveFile(const string& indexFilename) {
+	int64_t size, modificationTime;
+	if(!statContigFile(size, modificationTime)) {
+		return false;
+	}
+
+	ofstream ofIndex(indexFilename.c_str(), ios::out | ios::binary);
+	if(ofIndex.fail()) {
+		return false;
+	}
+
+	ofIndex.write(CONTIG_INDEX_MAGIC, 4);
+	writeValue<int32_t>(ofIndex, CONTIG_INDEX_VERSION);
+	writeValue<int64_t>(ofIndex, size);
+	writeValue<int64_t>(ofIndex, modificationTime);
+	writeString(ofIndex, groupSeparator());
+
+	writeValue<int32_t>(ofIndex, _readGroups.size());
+	vector<string>::iterator itGroups;
+	for(itGroups = _readGroups.begin(); itGroups != _readGroups.end(); itGroups++) {
+		writeString(ofIndex, *itGroups);
+	}
+
+	writeValue<int32_t>(ofIndex, _contigs.size());
+	vector<ContigIndexEntry>::iterator itContigs;
+	for(itContigs = _contigs.begin(); itContigs != _contigs.end(); itContigs++) {
+		writeString(ofIndex, itContigs->name);
+		writeValue<uint64_t>(ofIndex, itContigs->offset);
+		writeValue<uint64_t>(ofIndex, itContigs->size);
+		writeValue<int32_t>(ofIndex, itContigs->readCount);
+		writeValue<int32_t>(ofIndex, itContigs->length);
+		writeValue<int32_t>(ofIndex, itContigs->readGroups.size());
+		vector<int>::iterator itGroup;
+		for(itGroup = itContigs->readGroups.begin(); itGroup != itContigs->readGroups.end(); itGroup++) {
+			writeValue<int32_t>(ofIndex, *itGroup);
+		}
+	}
+
+	ofIndex.close();
+	if(ofIndex.fail()) {
+		remove(indexFilename.c_str());
+		return false;
+	}
+
+	Logger::getLogger()->log(QSNP_INFO, "wrote contig index: " + indexFilename);
+	_bLoaded = true;
+	return true;
+}
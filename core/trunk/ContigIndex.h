@@ -0,0 +1,81 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CONTIGINDEX_H__
+#define __CONTIGINDEX_H__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+using namespace std;
+
+struct ContigIndexEntry {
+	string			name;
+	uint64_t		offset;		// stream position of the first line or record
+	uint64_t		size;		// stream positions up to the end of the block, 0 if not contiguous
+	int				readCount;
+	int				length;
+	vector<int>		readGroups;	// indices in the read group list of the index
+};
+
+// sidecar index with the statistics and the position of every contig in a
+// contig file. It is stored next to the contig file (or in the output
+// directory if that is not writable) and is only used as long as the size
+// and modification time of the contig file match.
+class ContigIndex
+{
+public:
+	ContigIndex(const string& contigFilename);
+	~ContigIndex(void);
+
+	bool load();
+	bool save();
+	void clear();
+
+	ContigIndexEntry& addContig(const string& name, uint64_t offset);
+	void addRead(ContigIndexEntry& contig, const string& group);
+
+	const ContigIndexEntry* findContig(const string& name);
+	const vector<ContigIndexEntry>& getContigs()	{ return _contigs; }
+	const vector<string>& getReadGroups()			{ return _readGroups; }
+	int getContigCount()							{ return _contigs.size(); }
+	int getContigNameCount()						{ return _contigMap.size(); }
+	bool isGrouped()								{ return _contigMap.size() == _contigs.size(); }
+	int getReadCount();
+	bool isLoaded()									{ return _bLoaded; }
+
+private:
+	bool loadFile(const string& indexFilename);
+	bool saveFile(const string& indexFilename);
+	bool statContigFile(int64_t& size, int64_t& modificationTime);
+	string groupSeparator();
+
+private:
+	string						_contigFilename;
+	vector<ContigIndexEntry>	_contigs;
+	map<string, int>			_contigMap;
+	vector<string>				_readGroups;
+	map<string, int>			_readGroupMap;
+	bool						_bLoaded;
+};
+
+#endif
@@ -23,20 +23,58 @@
 #include "SeqRead.h"
 #include "Contig.h"
 #include "SAMFile.h"
+#include "BAMFile.h"
+#include "CompressedFile.h"
 #include "ContigProvider.h"
 
-ContigProvider::ContigProvider(void): _pContigFile(NULL)
+ContigProvider::ContigProvider(void): _pContigFile(NULL), _pRegions(NULL), _pReference(NULL), _iTarget(0), _bStreaming(false)
 {
 }
 
 ContigProvider::~ContigProvider(void)
 {
 	delete _pContigFile;
+	delete _pRegions;
+	delete _pReference;
 }
 
 bool ContigProvider::init() {
 	ios_base::sync_with_stdio(false);
-	string contigFilename = Configuration::getConfig()->getString("contigFileName");
+	Configuration* pConfig = Configuration::getConfig();
+
+	if(!openContigFile(pConfig->getString("contigFileName"))) {
+		return false;
+	}
+
+	// a run restricted to target regions only visits the target contigs
+	string regionsFilename = pConfig->getString("regionsFile");
+	if(!regionsFilename.empty()) {
+		_pRegions = new RegionList();
+		if(!_pRegions->load(regionsFilename)) {
+			return false;
+		}
+		// on standard input the reads of the other contigs are dropped while reading
+		_pContigFile->setRegions(_pRegions);
+		_iTarget = 0;
+	}
+
+	// SAM and BAM contigs take their sequence from the reference instead of the consensus of the reads
+	string referenceFilename = pConfig->getString("referenceFile");
+	if(!referenceFilename.empty()) {
+		_pReference = new ReferenceFile(referenceFilename);
+		if(!_pReference->openFile()) {
+			return false;
+		}
+		_pContigFile->setReference(_pReference);
+	}
+
+	return true;
+}
+
+bool ContigProvider::openContigFile(const string& contigFilename) {
+	if(contigFilename == STDIN_FILENAME) {
+		return openStandardInput();
+	}
 
 	ifstream contigFile;
 	contigFile.open(contigFilename.c_str(),ios::in);
@@ -46,6 +84,26 @@ bool ContigProvider::init() {
 	}
 	contigFile.close();
 
+	// compressed SAM and ACE files are decompressed while they are read
+	Compression compression = CompressedFile::detectCompression(contigFilename);
+	if(!CompressedFile::isSupported(compression)) {
+		Logger::getLogger()->log(QSNP_ERROR, "reading " + CompressedFile::compressionName(compression) + " compressed files is not supported by this build: " + contigFilename);
+		return false;
+	}
+	if(compression != COMPRESSION_NONE) {
+		Logger::getLogger()->log(QSNP_INFO, "Contig file is " + CompressedFile::compressionName(compression) + " compressed: " + contigFilename);
+	}
+
+	// BAM files are recognized by their magic bytes
+	BAMFile* pBAMFile = new BAMFile(contigFilename);
+
+	if(pBAMFile->isValid()) {
+		Logger::getLogger()->log(QSNP_INFO, "Starting to read BAM file: " + contigFilename);
+		_pContigFile = pBAMFile;
+		return true;
+	}
+
+	delete pBAMFile;
 
 	ACEFile* pACEFile = new ACEFile(contigFilename);
 	
@@ -86,6 +144,25 @@ bool ContigProvider::init() {
     return false;
 }
 
+// standard input is read once from start to end, the format is sniffed from
+// the lines that are still in the buffer. Only SAM is supported on a pipe.
+bool ContigProvider::openStandardInput() {
+	SAMFile* pSAMFile = new SAMFile(STDIN_FILENAME);
+
+	if(pSAMFile->isValid()) {
+		Logger::getLogger()->log(QSNP_INFO, "Starting to read SAM from standard input");
+		_pContigFile = pSAMFile;
+		_bStreaming = true;
+		return true;
+	}
+
+	delete pSAMFile;
+
+	Logger::getLogger()->log(QSNP_ERROR, "No SAM input on standard input");
+
+	return false;
+}
+
 int ContigProvider::getReadCount()
 {
     return _pContigFile->readCount();
@@ -93,6 +170,10 @@ int ContigProvider::getReadCount()
 
 int ContigProvider::getContigCount()
 {
+    if(_pRegions != NULL && !_bStreaming) {
+        return _pRegions->getContigNames().size();
+    }
+
     return _pContigFile->contigCount();
 }
 
@@ -102,5 +183,27 @@ vector<string> &ContigProvider::getReadGroups()
 }
 
 Contig* ContigProvider::nextContig() {
+	if(_pRegions != NULL && !_bStreaming) {
+		// seek to each target contig, contigs missing from the file are skipped
+		const vector<string>& targets = _pRegions->getContigNames();
+		while(_iTarget < static_cast<int>(targets.size())) {
+			Contig* pContig = _pContigFile->getContig(targets[_iTarget++]);
+			if(pContig != NULL) {
+				return pContig;
+			}
+		}
+		return NULL;
+	}
+
 	return _pContigFile->nextContig();
 }
+
+// fetch a single contig by name without reading the contigs before it,
+// nextContig continues after the fetched contig
+Contig* ContigProvider::getContig(const string& name) {
+	return _pContigFile->getContig(name);
+}
+
+vector<Contig*> ContigProvider::getContigs(const vector<string>& names) {
+	return _pContigFile->getContigs(names);
+}
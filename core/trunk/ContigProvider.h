@@ -23,6 +23,8 @@
 
 #include <vector>
 #include "ACEFile.h"
+#include "RegionList.h"
+#include "ReferenceFile.h"
 
 class ContigProvider
 {
@@ -31,14 +33,24 @@ public:
 	~ContigProvider(void);
 
 	Contig* nextContig();
+	Contig* getContig(const string& name);
+	vector<Contig*> getContigs(const vector<string>& names);
 	bool init();
 
     int getReadCount();
     int getContigCount();
     vector<string>& getReadGroups();
 
+private:
+	bool openContigFile(const string& contigFilename);
+	bool openStandardInput();
+
 private:
 	ContigFile* _pContigFile;
+	RegionList* _pRegions;
+	ReferenceFile* _pReference;
+	int         _iTarget;
+	bool        _bStreaming;
 };
 
 #endif
@@ -23,51 +23,63 @@
 #include "SeqRead.h"
 #include "Variation.h"
 #include "Contig.h"
+#include "ReadAlleles.h"
 #include "HaploType.h"
 
 HaploType::HaploType(Contig* pContig, int id) : 
     _pContig (pContig), _id(id), _bModified(true), _cReads(0), _lastVariablePosition(-1)
 {
-	_singleSNPThreshold = Configuration::getConfig()->getDouble("similarityPerPolymorphicSite");
-	_allSNPThreshold = Configuration::getConfig()->getDouble("similarityAllPolymorphicSites");
+	_singleSNPThreshold = _pContig->getParameters().similarityPerPolymorphicSite;
+	_allSNPThreshold = _pContig->getParameters().similarityAllPolymorphicSites;
 }
 
 HaploType::~HaploType(void)
 {
 }
 
-void HaploType::matchRead(SeqRead* pRead, int& match, int& misMatch, map<int,int>& varNuc) {
-    Configuration* pConfig = Configuration::getConfig();
-    const vector<Variation*>& variations = _pContig->getVariations();
-    vector<Variation*>::const_iterator itVar;
-    for ( itVar=variations.begin(); itVar != variations.end(); itVar++) {
-        if((*itVar)->isHighConfidence()) {
-            int pos = (*itVar)->getPos();
-            char cNuc = pRead->getNucleotideAt(pos);
-            int iNuc = pConfig->nuc2int(cNuc);
-            if(iNuc != -1) {
-                varNuc[pos] = iNuc;
-                int iMatch = matchAt(pos, cNuc);
-                if(iMatch == 1) {
-                    match++;
-                } else if(iMatch == -1) {
-                    misMatch++;
-                }
-            }
+void* HaploType::operator new(size_t size, Contig* pContig) {
+	return pContig->getArena().allocate(size);
+}
+
+// only called when the constructor throws, the memory stays in the arena
+void HaploType::operator delete(void* /*pMemory*/, Contig* /*pContig*/) {
+}
+
+// count the high confidence variations where the read matches or mismatches
+// this haplotype, variations without reads in the haplotype are not counted
+void HaploType::matchRead(const AlleleVector& alleles, int& match, int& misMatch) {
+    if(_informative.empty()) {
+        return;
+    }
+
+    int nDifferentNucs = _pContig->getParameters().cNucs;
+    int cWords = _informative.size();
+    for(int iWord = 0; iWord < alleles.cWords; iWord++) {
+        int iHapWord = alleles.firstWord + iWord;
+        uint64_t informative = alleles.coverage[iWord] & _informative[iHapWord];
+        if(informative == 0) {
+            continue;
+        }
+
+        int cMatch = 0;
+        for(int iNuc = 0; iNuc < nDifferentNucs; iNuc++) {
+            cMatch += ReadAlleles::countBits(alleles.alleles[iNuc * alleles.cWords + iWord] & _accepted[iNuc * cWords + iHapWord]);
         }
+        match += cMatch;
+        misMatch += ReadAlleles::countBits(informative) - cMatch;
     }
 }
 
 bool HaploType::tryAddRead(SeqRead* pRead) {
 	int match = 0;
 	int misMatch = 0;
-	map<int,int> varNuc;
+	const AlleleVector& alleles = _pContig->getReadAlleles()->getAlleles(pRead);
 
-    matchRead(pRead, match, misMatch, varNuc);
+    matchRead(alleles, match, misMatch);
 
 	if(_reads.empty()) {
 		// if this is the first read, always add it
-		addRead(pRead, varNuc);
+		addRead(pRead, alleles);
 		return true;
 	}
 
@@ -93,37 +105,73 @@ bool HaploType::tryAddRead(SeqRead* pRead) {
 		return false;
 	}
 
-	addRead(pRead, varNuc);
+	addRead(pRead, alleles);
 	return true;
 }
 
-void HaploType::addRead(SeqRead* pRead, const map<int, int>& varNuc) {
+void HaploType::addRead(SeqRead* pRead, const AlleleVector& alleles) {
 	Logger::getLogger()->log(QSNP_DEBUG, "HaploType::addRead");
 	_bModified = true;
 	_reads.push_back(pRead);
 	_cReads++;
 	pRead->setHaploType(this);
 
-    map<int,int>::const_iterator itVar;
-
-	Configuration* pConfig = Configuration::getConfig();
+	ReadAlleles* pReadAlleles = _pContig->getReadAlleles();
+	int nDifferentNucs = _pContig->getParameters().cNucs;
+	int cWords = pReadAlleles->getWordCount();
+	if(_informative.size() != static_cast<size_t>(cWords)) {
+		_informative.assign(cWords, 0);
+		_accepted.assign(nDifferentNucs * cWords, 0);
+	}
 
-	for(itVar = varNuc.begin(); itVar != varNuc.end(); itVar++) {
-		if (_varNuc.count((*itVar).first) == 0) {
-				vector<int> rgNuc (pConfig->getNumberOfNucs(), 0);
-				_varNuc[(*itVar).first] = rgNuc;
+	for(int iWord = 0; iWord < alleles.cWords; iWord++) {
+		for(int iBit = 0; iBit < 64; iBit++) {
+			uint64_t bit = static_cast<uint64_t>(1) << iBit;
+			if((alleles.coverage[iWord] & bit) == 0) {
+				continue;
+			}
+
+			int iNuc = 0;
+			while((alleles.alleles[iNuc * alleles.cWords + iWord] & bit) == 0) {
+				iNuc++;
+			}
+
+			int iVariation = (alleles.firstWord + iWord) * 64 + iBit;
+			vector<int>& rgNuc = _varNuc[pReadAlleles->getPosition(iVariation)];
+			if (rgNuc.empty()) {
+				rgNuc.resize(nDifferentNucs, 0);
+			}
+			rgNuc[iNuc]++;
+			updateAccepted(iVariation, rgNuc);
 		}
-		_varNuc[(*itVar).first][(*itVar).second]++; 
 	}
 }
 
 void HaploType::addRead(SeqRead* pRead) {
-    int match = 0;
-    int misMatch = 0;
-    map<int,int> varNuc;
-    matchRead(pRead,match,misMatch,varNuc);
+    addRead(pRead, _pContig->getReadAlleles()->getAlleles(pRead));
+}
 
-    addRead(pRead,varNuc);
+// set the bits of a variation after its counts changed, a nucleotide matches
+// when its share of the reads of this haplotype reaches the threshold
+void HaploType::updateAccepted(int iVariation, const vector<int>& nucCount) {
+	int cWords = _informative.size();
+	int iWord = iVariation / 64;
+	uint64_t bit = static_cast<uint64_t>(1) << (iVariation % 64);
+	_informative[iWord] |= bit;
+
+	int cReads = 0;
+	for (size_t iNuc = 0; iNuc < nucCount.size(); iNuc++) {
+		cReads += nucCount[iNuc];
+	}
+
+	for (size_t iNuc = 0; iNuc < nucCount.size(); iNuc++) {
+		double similarity = nucCount[iNuc] * 1.0 / cReads;
+		if (nucCount[iNuc] > 0 && similarity >= _singleSNPThreshold) {
+			_accepted[iNuc * cWords + iWord] |= bit;
+		} else {
+			_accepted[iNuc * cWords + iWord] &= ~bit;
+		}
+	}
 }
 
 char HaploType::getNucleotideAt(int pos)
@@ -132,14 +180,14 @@ char HaploType::getNucleotideAt(int pos)
         // return a space if there is not information at this position
         return ' ';
     }
-    Configuration* pConfig = Configuration::getConfig();
+    const RunParameters& parameters = _pContig->getParameters();
 
     int iMax = 0;
-    for (int i = 1; i < pConfig->getNumberOfNucs(); i++) {
+    for (int i = 1; i < parameters.cNucs; i++) {
         iMax = (_varNuc[pos][iMax] < _varNuc[pos][i]) ? i : iMax;
     }
 
-    return pConfig->int2nuc(iMax);
+    return parameters.int2nuc(iMax);
 }
 
 int HaploType::getLastVariablePosition()
@@ -156,38 +204,6 @@ int HaploType::getLastVariablePosition()
     return _lastVariablePosition;
 }
 
-int HaploType::matchAt(int pos, char queryNucleotide) {
-	if(_varNuc.count(pos) == 0) {
-		// no for this position (yet)
-		return 0;
-	}
-
-	Configuration* pConfig = Configuration::getConfig();
-	int iNuc = pConfig->nuc2int(queryNucleotide);
-	if(iNuc == -1) {
-		// not a normal nucleotide, ignore
-		return 0;
-	}
-
-	int match = _varNuc[pos][iNuc];
-	if (match == 0) {
-		// if there are no matches, there can only be mismatches
-		return -1;
-	}
-
-	int misMatch = 0;
-
-	for (int i = 0; i < pConfig->getNumberOfNucs(); i++) {
-		if (i != iNuc) {
-			misMatch += _varNuc[pos][i];
-		}
-	}
-
-	double similarity = match*1.0 / (match + misMatch);
-
-	return (similarity < _singleSNPThreshold) ? -1 : 1;
-}
-
 const string HaploType::toString() {
 	stringstream result;
 	string separator;
@@ -24,9 +24,11 @@
 #include <list>
 #include <string>
 #include <map>
+#include <stdint.h>
 
 class Contig;
 class SeqRead;
+struct AlleleVector;
 
 using namespace std;
 
@@ -35,6 +37,10 @@ class HaploType
 public:
 	HaploType(Contig* pContig, int id);
 	~HaploType(void);
+	// allocated in the arena of the contig: new (pContig) HaploType(...)
+	static void* operator new(size_t size, Contig* pContig);
+	static void operator delete(void* pMemory, Contig* pContig);
+
     bool tryAddRead(SeqRead*);
 	
 	int getReadCount() { return _cReads; }
@@ -52,9 +58,9 @@ public:
     int getLastVariablePosition();
 
 private:
-	int	matchAt(int, char);
-    void matchRead(SeqRead* pRead, int& match, int& misMatch, map<int,int>& varNuc);
-	void addRead(SeqRead*,const map<int,int>&);
+    void matchRead(const AlleleVector& alleles, int& match, int& misMatch);
+	void addRead(SeqRead*, const AlleleVector& alleles);
+	void updateAccepted(int iVariation, const vector<int>& nucCount);
 
 private:
 	Contig*					_pContig;
@@ -62,6 +68,11 @@ private:
 	int						_cReads;
 	vector<int>				_definingSNP;
 	map<int,vector<int> >	_varNuc;
+	// bit vectors over the high confidence variations of the contig, see
+	// ReadAlleles: the variations with reads and per nucleotide the
+	// variations where it matches this haplotype
+	vector<uint64_t>		_informative;
+	vector<uint64_t>		_accepted;
 	double					_singleSNPThreshold;
 	double					_allSNPThreshold;
 	int						_id;
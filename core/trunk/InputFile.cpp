@@ -0,0 +1,88 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include "Configuration.h"
+#include "BGZFFile.h"
+#include "CompressedFile.h"
+#include "InputFile.h"
+
+using namespace std;
+
+InputFile::InputFile(void): istream(NULL), _pBuffer(NULL), _bOwnsBuffer(false)
+{
+}
+
+InputFile::~InputFile(void)
+{
+	close();
+}
+
+void InputFile::open(const char* filename, ios_base::openmode mode) {
+	close();
+
+	if(strcmp(filename, STDIN_FILENAME) == 0) {
+		_pBuffer = cin.rdbuf();
+		_bOwnsBuffer = false;
+		rdbuf(_pBuffer);
+		return;
+	}
+
+	_bOwnsBuffer = true;
+	int cThreads = Configuration::getConfig()->getInt("decompressionThreads");
+	Compression compression = CompressedFile::detectCompression(filename);
+	if(compression == COMPRESSION_BGZF) {
+		BGZFStreamBuf* pBuffer = new BGZFStreamBuf(filename, cThreads);
+		if(pBuffer->openFile()) {
+			_pBuffer = pBuffer;
+		} else {
+			delete pBuffer;
+		}
+	} else if(compression != COMPRESSION_NONE) {
+		CompressedStreamBuf* pBuffer = new CompressedStreamBuf(filename, compression, cThreads > 0);
+		if(pBuffer->openFile()) {
+			_pBuffer = pBuffer;
+		} else {
+			delete pBuffer;
+		}
+	} else {
+		filebuf* pBuffer = new filebuf();
+		if(pBuffer->open(filename, mode) != NULL) {
+			_pBuffer = pBuffer;
+		} else {
+			delete pBuffer;
+		}
+	}
+
+	rdbuf(_pBuffer);
+	if(_pBuffer == NULL) {
+		setstate(ios::failbit);
+	}
+}
+
+void InputFile::close() {
+	rdbuf(NULL);
+	if(_bOwnsBuffer) {
+		delete _pBuffer;
+	}
+	_pBuffer = NULL;
+}
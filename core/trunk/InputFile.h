@@ -0,0 +1,52 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __INPUTFILE_H__
+#define __INPUTFILE_H__
+
+#include <string>
+#include <istream>
+#include <streambuf>
+
+using namespace std;
+
+// the file name that reads from standard input
+static const char* const STDIN_FILENAME = "-";
+
+// input stream that can be used instead of an ifstream, BGZF compressed
+// files are decompressed on the fly by a pool of inflater threads and gzip
+// or zstd compressed files by a background thread. The file name "-" reads
+// from standard input, which cannot seek.
+class InputFile : public istream
+{
+public:
+	InputFile(void);
+	~InputFile(void);
+
+	void open(const char* filename, ios_base::openmode mode = ios::in);
+	bool is_open() { return _pBuffer != NULL; }
+	void close();
+
+private:
+	streambuf*	_pBuffer;
+	bool		_bOwnsBuffer;
+};
+
+#endif
@@ -0,0 +1,287 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <algorithm>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "Logger.h"
+#include "CompressedFile.h"
+#include "LineReader.h"
+
+using namespace std;
+
+static const size_t LINE_BUFFER_SIZE = 1 << 20;
+
+LineReader::LineReader(const string& filename): _filename(filename), _bOpen(false), _pMap(NULL), _mapSize(0),
+  _position(0), _bufferStart(0), _bufferEnd(0), _bStreamEOF(false),
+  _bStdin(filename == STDIN_FILENAME), _cStreamBytes(0)
+{
+}
+
+LineReader::~LineReader(void)
+{
+#ifndef _WIN32
+	if(_mapSize > 0) {
+		munmap(const_cast<char*>(_pMap), _mapSize);
+	}
+#endif
+}
+
+bool LineReader::openFile() {
+	if(_bOpen) {
+		return true;
+	}
+
+	if(!_bStdin && CompressedFile::detectCompression(_filename) == COMPRESSION_NONE && mapFile()) {
+		_bOpen = true;
+		return true;
+	}
+
+	_ifFile.open(_filename.c_str(), ios::in | ios::binary);
+	if (_ifFile.fail()) {
+		Logger::getLogger()->log(QSNP_ERROR, "could not open file: " + _filename);
+		return false;
+	}
+
+	_buffer.resize(LINE_BUFFER_SIZE);
+	_bOpen = true;
+	return true;
+}
+
+// map the whole file into memory, returns false if that is not possible
+bool LineReader::mapFile() {
+#ifdef _WIN32
+	return false;
+#else
+	int fd = open(_filename.c_str(), O_RDONLY);
+	if(fd == -1) {
+		return false;
+	}
+
+	struct stat fileStat;
+	if(fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+		close(fd);
+		return false;
+	}
+
+	_mapSize = fileStat.st_size;
+	_position = 0;
+	if(_mapSize == 0) {
+		// nothing to map, an empty file just has no lines
+		close(fd);
+		_pMap = "";
+		return true;
+	}
+
+	void* pMap = mmap(NULL, _mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(pMap == MAP_FAILED) {
+		_mapSize = 0;
+		return false;
+	}
+
+	madvise(pMap, _mapSize, MADV_SEQUENTIAL);
+	_pMap = static_cast<const char*>(pMap);
+	return true;
+#endif
+}
+
+bool LineReader::nextLine(const char*& line, int& length) {
+	if(!openFile()) {
+		return false;
+	}
+
+	if(_pMap != NULL) {
+		if(_position >= _mapSize) {
+			return false;
+		}
+
+		line = _pMap + _position;
+		const char* lineEnd = static_cast<const char*>(memchr(line, '\n', _mapSize - _position));
+		if(lineEnd == NULL) {
+			lineEnd = _pMap + _mapSize;
+		}
+		length = lineEnd - line;
+		_position += length + 1;
+	} else {
+		const char* lineEnd = NULL;
+		while(true) {
+			lineEnd = static_cast<const char*>(memchr(&_buffer[0] + _bufferStart, '\n', _bufferEnd - _bufferStart));
+			if(lineEnd != NULL || !fillBuffer()) {
+				break;
+			}
+		}
+
+		if(_bufferStart == _bufferEnd) {
+			return false;
+		}
+
+		line = &_buffer[0] + _bufferStart;
+		if(lineEnd == NULL) {
+			// last line without a line end
+			lineEnd = &_buffer[0] + _bufferEnd;
+		}
+		length = lineEnd - line;
+		_bufferStart += length + 1;
+		if(_bufferStart > _bufferEnd) {
+			_bufferStart = _bufferEnd;
+		}
+	}
+
+	// windows line ends
+	if(length > 0 && line[length - 1] == '\r') {
+		length--;
+	}
+
+	return true;
+}
+
+// move the unread data to the front of the buffer and read more after it
+// every read is a chunk that is contiguous in the stream, so the stream
+// position of a line can be found from the chunk it starts in
+bool LineReader::fillBuffer() {
+	if(_bStreamEOF) {
+		return false;
+	}
+
+	size_t remaining = _bufferEnd - _bufferStart;
+	if(_bufferStart > 0) {
+		while(_chunks.size() > 1 && _chunks[1].bufferPosition <= _bufferStart) {
+			_chunks.erase(_chunks.begin());
+		}
+		if(!_chunks.empty() && _chunks[0].bufferPosition < _bufferStart) {
+			_chunks[0].streamPosition += _bufferStart - _chunks[0].bufferPosition;
+			_chunks[0].bufferPosition = _bufferStart;
+		}
+		for(size_t iChunk = 0; iChunk < _chunks.size(); iChunk++) {
+			_chunks[iChunk].bufferPosition -= _bufferStart;
+		}
+
+		memmove(&_buffer[0], &_buffer[0] + _bufferStart, remaining);
+		_bufferStart = 0;
+		_bufferEnd = remaining;
+	}
+
+	if(_bufferEnd == _buffer.size()) {
+		// a line longer than the buffer
+		_buffer.resize(_buffer.size() * 2);
+	}
+
+	streambuf* pStreamBuffer = _ifFile.rdbuf();
+	if(pStreamBuffer == NULL || pStreamBuffer->sgetc() == char_traits<char>::eof()) {
+		_bStreamEOF = true;
+		return false;
+	}
+
+	streamsize available = min(static_cast<streamsize>(_buffer.size() - _bufferEnd), pStreamBuffer->in_avail());
+	LineChunk chunk;
+	chunk.bufferPosition = _bufferEnd;
+	if(_bStdin) {
+		chunk.streamPosition = _cStreamBytes;
+	} else {
+		chunk.streamPosition = static_cast<uint64_t>(streamoff(pStreamBuffer->pubseekoff(0, ios::cur, ios::in)));
+	}
+
+	size_t cRead = pStreamBuffer->sgetn(&_buffer[0] + _bufferEnd, max(available, static_cast<streamsize>(1)));
+	if(cRead == 0) {
+		_bStreamEOF = true;
+		return false;
+	}
+	_cStreamBytes += cRead;
+
+	_chunks.push_back(chunk);
+	_bufferEnd += cRead;
+	return true;
+}
+
+// the stream position of the next line, a byte offset for uncompressed
+// files and a virtual offset for BGZF compressed files
+uint64_t LineReader::tell() {
+	if(!openFile()) {
+		return 0;
+	}
+
+	if(_pMap != NULL) {
+		return min(_position, _mapSize);
+	}
+
+	for(size_t iChunk = _chunks.size(); iChunk > 0; iChunk--) {
+		const LineChunk& chunk = _chunks[iChunk - 1];
+		if(chunk.bufferPosition <= _bufferStart) {
+			return chunk.streamPosition + (_bufferStart - chunk.bufferPosition);
+		}
+	}
+
+	if(_bStdin) {
+		return _cStreamBytes;
+	}
+
+	return static_cast<uint64_t>(streamoff(_ifFile.rdbuf()->pubseekoff(0, ios::cur, ios::in)));
+}
+
+// continue reading at a position returned by tell
+bool LineReader::seek(uint64_t position) {
+	if(!openFile()) {
+		return false;
+	}
+
+	if(_pMap != NULL) {
+		if(position > _mapSize) {
+			return false;
+		}
+		_position = position;
+		return true;
+	}
+
+	// positions that are still in the buffer need no seek in the stream
+	for(size_t iChunk = 0; iChunk < _chunks.size(); iChunk++) {
+		const LineChunk& chunk = _chunks[iChunk];
+		size_t chunkEnd = (iChunk + 1 < _chunks.size()) ? _chunks[iChunk + 1].bufferPosition : _bufferEnd;
+		if(position >= chunk.streamPosition && position - chunk.streamPosition <= chunkEnd - chunk.bufferPosition) {
+			_bufferStart = chunk.bufferPosition + (position - chunk.streamPosition);
+			return true;
+		}
+	}
+
+	if(_bStdin) {
+		if(position == _cStreamBytes && _bufferStart == _bufferEnd) {
+			return true;
+		}
+		Logger::getLogger()->log(QSNP_ERROR, "cannot seek in standard input");
+		return false;
+	}
+
+	_ifFile.clear();
+	_ifFile.seekg(streamoff(position), ios::beg);
+	_bufferStart = 0;
+	_bufferEnd = 0;
+	_chunks.clear();
+	_bStreamEOF = false;
+	return !_ifFile.fail();
+}
+
+bool LineReader::rewind() {
+	return seek(0);
+}
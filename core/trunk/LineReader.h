@@ -0,0 +1,81 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __LINEREADER_H__
+#define __LINEREADER_H__
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "InputFile.h"
+
+using namespace std;
+
+struct LineChunk {
+	size_t		bufferPosition;
+	uint64_t	streamPosition;
+};
+
+// returns the lines of a text file without copying them. Uncompressed files
+// are memory mapped, compressed files (BGZF, gzip or zstd) and standard input
+// are read in large blocks through an InputFile. A line is valid until the next call to
+// nextLine and does not include the line end.
+//
+// Standard input cannot seek, but positions that are still in the buffer
+// can be returned to, so the start of the input can be sniffed and read again.
+class LineReader
+{
+public:
+	LineReader(const string& filename);
+	~LineReader(void);
+
+	bool openFile();
+	bool nextLine(const char*& line, int& length);
+	bool rewind();
+	uint64_t tell();
+	bool seek(uint64_t position);
+	bool isMapped()		{ return _pMap != NULL; }
+	uint64_t mapSize()	{ return _mapSize; }
+
+private:
+	bool mapFile();
+	bool fillBuffer();
+
+private:
+	string			_filename;
+	bool			_bOpen;
+
+	// memory mapped file
+	const char*		_pMap;
+	size_t			_mapSize;
+	size_t			_position;
+
+	// buffered stream for input that cannot be mapped
+	InputFile		_ifFile;
+	vector<char>	_buffer;
+	size_t			_bufferStart;
+	size_t			_bufferEnd;
+	vector<LineChunk>	_chunks;
+	bool			_bStreamEOF;
+	bool			_bStdin;
+	uint64_t		_cStreamBytes;	// read from standard input so far
+};
+
+#endif
@@ -0,0 +1,214 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include "Configuration.h"
+#include "RunParameters.h"
+#include "SeqRead.h"
+#include "Pileup.h"
+
+using namespace std;
+
+Pileup::Pileup(int cColumns): _cColumns(cColumns)
+{
+	init(RunParameters(Configuration::getConfig()));
+}
+
+Pileup::Pileup(int cColumns, const RunParameters& parameters): _cColumns(cColumns)
+{
+	init(parameters);
+}
+
+void Pileup::init(const RunParameters& parameters) {
+	_cNucs = parameters.cNucs;
+	_counts.resize(_cNucs, vector<int>(_cColumns, 0));
+	_minQualityScore = parameters.minSNPQualityScore;
+
+	// a table lookup instead of a configuration call per base
+	copy(parameters.nucIndex, parameters.nucIndex + 256, _nucIndex);
+	_nucs = parameters.nucs;
+}
+
+Pileup::~Pileup(void)
+{
+}
+
+// count the nucleotides of a read starting at a zero-based column, bases
+// outside the pileup and characters that are no nucleotide are not counted
+void Pileup::addRead(int startColumn, const string& sequence) {
+	int iBase = max(0, -startColumn);
+	int end = min(static_cast<int>(sequence.size()), _cColumns - startColumn);
+	const char* bases = sequence.data();
+
+	for(; iBase < end; iBase++) {
+		int iNuc = _nucIndex[static_cast<unsigned char>(bases[iBase])];
+		if(iNuc != -1) {
+			_counts[iNuc][startColumn + iBase]++;
+		}
+	}
+}
+
+// count the nucleotides of the quality clipped part of a contig read, and
+// the columns where the read is of high quality
+void Pileup::addRead(SeqRead* pRead) {
+	if(_cHighQualityReads.size() != static_cast<size_t>(_cColumns)) {
+		_cHighQualityReads.resize(_cColumns, 0);
+	}
+
+	int start = pRead->getStartPosition();
+	const char* bases = pRead->getSequence().data();
+	int first = max(0, start + pRead->getClippedsequenceStart());
+	int last = min(_cColumns - 1, start + pRead->getClippedsequenceEnd());
+	for(int column = first; column <= last; column++) {
+		int iNuc = _nucIndex[static_cast<unsigned char>(bases[column - start])];
+		if(iNuc != -1) {
+			_counts[iNuc][column]++;
+		}
+	}
+
+	first = max(0, start + pRead->getHighQualityStart());
+	last = min(_cColumns - 1, start + pRead->getHighQualityEnd());
+	for(int column = first; column <= last; column++) {
+		if(pRead->isHighQuality(column, _minQualityScore)) {
+			_cHighQualityReads[column]++;
+		}
+	}
+}
+
+// count the high quality nucleotides and the nucleotides per read group of
+// the reads in the given columns. Columns that are counted already are skipped.
+void Pileup::countColumns(const list<SeqRead*>& reads, const vector<int>& columns) {
+	vector<int> newColumns;
+	vector<int>::const_iterator itColumns;
+	for(itColumns = columns.begin(); itColumns != columns.end(); itColumns++) {
+		if(*itColumns >= 0 && *itColumns < _cColumns && _columnIndex.count(*itColumns) == 0) {
+			newColumns.push_back(*itColumns);
+		}
+	}
+	sort(newColumns.begin(), newColumns.end());
+	newColumns.erase(unique(newColumns.begin(), newColumns.end()), newColumns.end());
+	if(newColumns.empty()) {
+		return;
+	}
+
+	int iFirstColumn = _columnIndex.size();
+	for(size_t iColumn = 0; iColumn < newColumns.size(); iColumn++) {
+		_columnIndex[newColumns[iColumn]] = iFirstColumn + iColumn;
+	}
+	size_t cCounts = _columnIndex.size() * _cNucs;
+	_hqCounts.resize(cCounts, 0);
+	for(size_t iGroup = 0; iGroup < _groupCounts.size(); iGroup++) {
+		_groupCounts[iGroup].resize(cCounts, 0);
+	}
+
+	list<SeqRead*>::const_iterator itReads;
+	for(itReads = reads.begin(); itReads != reads.end(); itReads++) {
+		SeqRead* pRead = *itReads;
+		int start = pRead->getStartPosition();
+		int first = start + pRead->getClippedsequenceStart();
+		int last = start + pRead->getClippedsequenceEnd();
+		const char* bases = pRead->getSequence().data();
+
+		vector<int>* pGroupCounts = NULL;
+		const string& group = pRead->getGroup();
+		if(!group.empty()) {
+			map<string, int>::iterator itGroup = _groupIndex.find(group);
+			if(itGroup == _groupIndex.end()) {
+				itGroup = _groupIndex.insert(make_pair(group, static_cast<int>(_groupCounts.size()))).first;
+				_groupCounts.push_back(vector<int>(cCounts, 0));
+			}
+			pGroupCounts = &_groupCounts[itGroup->second];
+		}
+
+		vector<int>::iterator itColumn = lower_bound(newColumns.begin(), newColumns.end(), first);
+		for(; itColumn != newColumns.end() && *itColumn <= last; itColumn++) {
+			int iNuc = _nucIndex[static_cast<unsigned char>(bases[*itColumn - start])];
+			if(iNuc == -1) {
+				continue;
+			}
+
+			int index = (iFirstColumn + (itColumn - newColumns.begin())) * _cNucs + iNuc;
+			if(pRead->isHighQuality(*itColumn, _minQualityScore)) {
+				_hqCounts[index]++;
+			}
+			if(pGroupCounts != NULL) {
+				(*pGroupCounts)[index]++;
+			}
+		}
+	}
+}
+
+// the high and low quality nucleotide counts of a selected column, false if
+// the column is not counted
+bool Pileup::getQualityCounts(int column, int* hqCounts, int* lqCounts) {
+	map<int, int>::iterator itColumn = _columnIndex.find(column);
+	if(itColumn == _columnIndex.end()) {
+		return false;
+	}
+
+	const int* counts = &_hqCounts[itColumn->second * _cNucs];
+	for(int iNuc = 0; iNuc < _cNucs; iNuc++) {
+		hqCounts[iNuc] = counts[iNuc];
+		lqCounts[iNuc] = _counts[iNuc][column] - counts[iNuc];
+	}
+
+	return true;
+}
+
+// the count of a nucleotide in the reads of a group in a selected column
+int Pileup::getGroupCount(int column, const string& group, int iNuc) {
+	map<int, int>::iterator itColumn = _columnIndex.find(column);
+	map<string, int>::iterator itGroup = _groupIndex.find(group);
+	if(itColumn == _columnIndex.end() || itGroup == _groupIndex.end() || iNuc < 0 || iNuc >= _cNucs) {
+		return 0;
+	}
+
+	return _groupCounts[itGroup->second][itColumn->second * _cNucs + iNuc];
+}
+
+// the most frequent nucleotide of every column, the first one in the
+// configuration order on a tie and N for a column without nucleotides
+string Pileup::consensus() {
+	if(_cColumns == 0) {
+		return string();
+	}
+
+	vector<int> maxCount(_counts.empty() ? vector<int>(_cColumns, 0) : _counts[0]);
+	vector<int> maxNuc(_cColumns, 0);
+
+	// a nucleotide at a time, so the inner loops run over contiguous arrays
+	for(int iNuc = 1; iNuc < _cNucs; iNuc++) {
+		const int* counts = &_counts[iNuc][0];
+		for(int column = 0; column < _cColumns; column++) {
+			bool bMore = counts[column] > maxCount[column];
+			maxCount[column] = bMore ? counts[column] : maxCount[column];
+			maxNuc[column] = bMore ? iNuc : maxNuc[column];
+		}
+	}
+
+	string sequence(_cColumns, 'N');
+	for(int column = 0; column < _cColumns; column++) {
+		if(maxCount[column] > 0) {
+			sequence[column] = _nucs[maxNuc[column]];
+		}
+	}
+
+	return sequence;
+}
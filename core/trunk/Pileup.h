@@ -0,0 +1,77 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __PILEUP_H__
+#define __PILEUP_H__
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+
+class SeqRead;
+struct RunParameters;
+
+using namespace std;
+
+// nucleotide counts per column of a contig. Every nucleotide of the
+// configuration (A, C, G, T and the gap) has a dense array of counts over
+// all columns, the reads are added with a direct walk over their bases.
+//
+// For the reads of a Contig the pileup also counts the high quality reads
+// per column. The high quality nucleotides and the nucleotides per read group
+// are only needed at the variations, they are counted for selected columns.
+class Pileup
+{
+public:
+	Pileup(int cColumns);
+	Pileup(int cColumns, const RunParameters& parameters);
+	~Pileup(void);
+
+	void addRead(int startColumn, const string& sequence);
+	void addRead(SeqRead* pRead);
+	void countColumns(const list<SeqRead*>& reads, const vector<int>& columns);
+	int getColumnCount()						{ return _cColumns; }
+	int getCount(int column, int iNuc)			{ return _counts[iNuc][column]; }
+	int getHighQualityReadCount(int column)		{ return _cHighQualityReads.empty() ? 0 : _cHighQualityReads[column]; }
+	bool getQualityCounts(int column, int* hqCounts, int* lqCounts);
+	int getGroupCount(int column, const string& group, int iNuc);
+	string consensus();
+
+private:
+	void init(const RunParameters& parameters);
+
+private:
+	int						_cColumns;
+	int						_cNucs;
+	vector< vector<int> >	_counts;
+	vector<int>				_cHighQualityReads;
+	int						_nucIndex[256];
+	string					_nucs;
+	int						_minQualityScore;
+
+	// counts of the selected columns, cNucs per column
+	map<int, int>			_columnIndex;
+	vector<int>				_hqCounts;
+	map<string, int>		_groupIndex;
+	vector< vector<int> >	_groupCounts;
+};
+
+#endif
@@ -39,6 +39,8 @@ using namespace std;
 void usage(char* programName) {
 	cout << programName << " [-outdir <outputdir>] [-minAlleles n]";
 	cout << " [-lq5 n] [-lq3 n] [-lq3p n] [-lqWeight n] [-minQualScore n] [-minMapQuality n ]";
+	cout << "   -includeFlags           only use SAM/BAM reads with all of these flag bits set (default: 0)" << endl;
+	cout << "   -excludeFlags           skip SAM/BAM reads with any of these flag bits set (default: 3844, unmapped, secondary, QC fail, duplicate and supplementary)" << endl;
 	cout << " [-minConf n] [-simPol n] [-simAll n] [-minHQReads n] [-reliableMarkers F/T]";
 	cout << " [-maxSNPsFlank n] [-indelLQ T/F] [-printSummaryLine T/F]";
 	cout << " [-printAlignment F/T] [-printHaploTypes F/T] [-useIUPACCodes F/T]";
@@ -49,7 +51,7 @@ void usage(char* programName) {
 
 	cout << endl;
 
-	cout << "   contigfile              a valid contig file in ACE or SAM format as produced by CAP3 and other tools" << endl;
+	cout << "   contigfile              a valid contig file in ACE, SAM or BAM format as produced by CAP3 and other tools, or - to read SAM from standard input" << endl;
 	cout << "   -outdir                 the directory for the log file and the csv data files (default: /tmp)" << endl;
 	cout << "   -lq5                    the number of nucleotides at the 5' end of each read that should be marked as low quality (default: 0)" << endl;
 	cout << "   -lq3                    the number of nucleotides at the 3' end of each read that should be marked as low quality (default: 0)" << endl;
@@ -75,6 +77,13 @@ void usage(char* programName) {
 	cout << "   -logLevel               logging level, 1 (only errors), 2 (warnings) or 3 (info) (default 1)" << endl;
 	cout << "   -showContigsWithoutSNP  report on all contigs, also the ones without SNPs (T/F, default; F)" << endl;
 	cout << "   -config                 load configuration file" << endl;
+	cout << "   -inflateThreads         number of threads decompressing BGZF compressed input, 0 to decompress in the reading thread, also for gzip or zstd input (default: 4)" << endl;
+	cout << "   -parseThreads           number of threads parsing an uncompressed SAM or ACE file in parallel, 0 or 1 to parse it in the reading thread (default: 0)" << endl;
+	cout << "   -contigIndex            read and write a .qsi index with the statistics and contig offsets of the input (T/F, default: T)" << endl;
+	cout << "   -groupContigs           group the reads of SAM input that is not sorted by reference in temporary files, also for standard input (T/F, default: F, files are checked with their contig index)" << endl;
+	cout << "   -groupMemory            memory in MB for grouping unsorted SAM input, beyond that the reads are spilled to files in the output directory (default: 1024)" << endl;
+	cout << "   -regions                a BED file or a list of contig names, only these contigs and regions are analysed" << endl;
+	cout << "   -reference              a FASTA file (indexed with samtools faidx) with the reference sequences of SAM or BAM input, instead of the consensus of the reads" << endl;
 	
 	return;
 }
@@ -95,6 +104,8 @@ bool parseOpt(int argc, char* argv[]) {
 	optionMap["simAll"]					= "similarityAllPolymorphicSites";
 	optionMap["minHQReads"]				= "minNumberOfHighQualityReads";
 	optionMap["minMapQuality"]			= "minimalMappingQuality";
+	optionMap["includeFlags"]		= "includeFlags";
+	optionMap["excludeFlags"]		= "excludeFlags";
 	optionMap["maxSNPsFlank"]			= "maxNumberOfSNPsInFlanks";
 	optionMap["indelLQ"]				= "indelLowQuality";
 	optionMap["printAlignment"]			= "printAlignment";
@@ -106,11 +117,18 @@ bool parseOpt(int argc, char* argv[]) {
 	optionMap["reliableMarkers"]		= "onlyReliableMarkers";
 	optionMap["useIUPACCodes"]			= "useIUPACCodes";
 	optionMap["showContigsWithoutSNP"]	= "showContigsWithoutSNP";
+	optionMap["inflateThreads"]		= "decompressionThreads";
+	optionMap["parseThreads"]		= "parsingThreads";
+	optionMap["contigIndex"]		= "useContigIndex";
+	optionMap["groupContigs"]		= "groupContigs";
+	optionMap["groupMemory"]		= "groupingMemory";
+	optionMap["regions"]			= "regionsFile";
+	optionMap["reference"]			= "referenceFile";
 	
 	int i = 1;
 	Configuration* pConfig = Configuration::getConfig();
 	while (i < argc) {
-		if(argv[i][0] == '-') {
+		if(argv[i][0] == '-' && argv[i][1] != '\0') {
 			char* currentOption = argv[i]+1;
 			if(strcmp(currentOption,"help") == 0) {
 				usage(argv[0]);
@@ -0,0 +1,103 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include "SeqRead.h"
+#include "Variation.h"
+#include "Contig.h"
+#include "ReadAlleles.h"
+
+using namespace std;
+
+ReadAlleles::ReadAlleles(Contig* pContig) :
+	_pContig(pContig), _cWords(0)
+{
+	_cNucs = _pContig->getParameters().cNucs;
+	_noAlleles.firstWord = 0;
+	_noAlleles.cWords = 0;
+	_noAlleles.coverage = NULL;
+	_noAlleles.alleles = NULL;
+
+	const vector<Variation*>& variations = _pContig->getVariations();
+	for(vector<Variation*>::const_iterator itVar = variations.begin(); itVar != variations.end(); itVar++) {
+		if((*itVar)->isHighConfidence()) {
+			_positions.push_back((*itVar)->getPos());
+		}
+	}
+	sort(_positions.begin(), _positions.end());
+	_cWords = (_positions.size() + 63) / 64;
+
+	const list<SeqRead*>& reads = _pContig->getReads();
+	for(list<SeqRead*>::const_iterator itReads = reads.begin(); itReads != reads.end(); itReads++) {
+		encodeRead(*itReads, _alleles[*itReads]);
+	}
+}
+
+ReadAlleles::~ReadAlleles(void)
+{
+}
+
+// the alleles of a read, empty for a read that is not in the contig
+const AlleleVector& ReadAlleles::getAlleles(SeqRead* pRead) {
+	map<SeqRead*, AlleleVector>::iterator itAlleles = _alleles.find(pRead);
+	return (itAlleles == _alleles.end()) ? _noAlleles : itAlleles->second;
+}
+
+int ReadAlleles::countBits(uint64_t word) {
+#ifdef __GNUC__
+	return __builtin_popcountll(word);
+#else
+	word = word - ((word >> 1) & 0x5555555555555555ULL);
+	word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+	word = (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	return static_cast<int>((word * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// set the bits of the variations within the clipped part of the read
+void ReadAlleles::encodeRead(SeqRead* pRead, AlleleVector& alleles) {
+	alleles = _noAlleles;
+
+	int start = pRead->getStartPosition() + pRead->getClippedsequenceStart();
+	int end = pRead->getStartPosition() + pRead->getClippedsequenceEnd();
+	int first = lower_bound(_positions.begin(), _positions.end(), start) - _positions.begin();
+	int last = upper_bound(_positions.begin(), _positions.end(), end) - _positions.begin() - 1;
+	if(first > last) {
+		return;
+	}
+
+	alleles.firstWord = first / 64;
+	alleles.cWords = last / 64 - alleles.firstWord + 1;
+	uint64_t* words = _pContig->getArena().allocateArray<uint64_t>((_cNucs + 1) * alleles.cWords);
+	fill(words, words + (_cNucs + 1) * alleles.cWords, 0);
+	alleles.coverage = words;
+	alleles.alleles = words + alleles.cWords;
+
+	const RunParameters& parameters = _pContig->getParameters();
+	for(int iVariation = first; iVariation <= last; iVariation++) {
+		int iNuc = parameters.nuc2int(pRead->getNucleotideAt(_positions[iVariation]));
+		if(iNuc != -1) {
+			int iWord = iVariation / 64 - alleles.firstWord;
+			uint64_t bit = static_cast<uint64_t>(1) << (iVariation % 64);
+			alleles.coverage[iWord] |= bit;
+			alleles.alleles[iNuc * alleles.cWords + iWord] |= bit;
+		}
+	}
+}
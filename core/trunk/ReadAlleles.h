@@ -0,0 +1,73 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __READALLELES_H__
+#define __READALLELES_H__
+
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+class Contig;
+class SeqRead;
+
+using namespace std;
+
+// the nucleotides of a read at the high confidence variations of its contig.
+// Bit i of a word stands for variation firstWord * 64 + i, in the order of
+// their positions. Only the words from the first to the last variation the
+// read covers are kept.
+struct AlleleVector {
+	int			firstWord;
+	int			cWords;
+	uint64_t*	coverage;	// the variations the read has a nucleotide at
+	uint64_t*	alleles;	// a plane of cWords per nucleotide
+};
+
+// bit vectors of the alleles of all reads of a contig, made once before the
+// haplotypes are built. Matching a read against a haplotype then takes a few
+// word operations per 64 variations instead of a lookup per variation.
+// The words are allocated in the arena of the contig.
+class ReadAlleles
+{
+public:
+	ReadAlleles(Contig* pContig);
+	~ReadAlleles(void);
+
+	int getVariationCount()					{ return _positions.size(); }
+	int getWordCount()						{ return _cWords; }
+	int getPosition(int iVariation)			{ return _positions[iVariation]; }
+	const AlleleVector& getAlleles(SeqRead* pRead);
+
+	static int countBits(uint64_t word);
+
+private:
+	void encodeRead(SeqRead* pRead, AlleleVector& alleles);
+
+private:
+	Contig*						_pContig;
+	vector<int>					_positions;
+	int							_cWords;
+	int							_cNucs;
+	map<SeqRead*, AlleleVector>	_alleles;
+	AlleleVector				_noAlleles;
+};
+
+#endif
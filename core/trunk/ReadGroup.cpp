@@ -2,12 +2,21 @@
 #include "SeqRead.h"
 #include "Variation.h"
 #include "Contig.h"
+#include "Pileup.h"
 #include "ReadGroup.h"
 
 ReadGroup::ReadGroup(string name, Contig* pContig): _name(name), _pContig(pContig)
 {
 }
 
+void* ReadGroup::operator new(size_t size, Contig* pContig) {
+    return pContig->getArena().allocate(size);
+}
+
+// only called when the constructor throws, the memory stays in the arena
+void ReadGroup::operator delete(void* /*pMemory*/, Contig* /*pContig*/) {
+}
+
 void ReadGroup::addRead(SeqRead* pRead)
 {
     _reads.push_back(pRead);
@@ -22,17 +31,11 @@ string ReadGroup::toCSV(int nPos, char majorAllele, char minorAllele)
 {
     stringstream csv;
 
-    int cMajorAllele = 0;
-    int cMinorAllele = 0;
-    list<SeqRead*>::iterator itReads;
-    for (itReads=_reads.begin(); itReads != _reads.end(); itReads++) {
-        char nuc = (*itReads)->getNucleotideAt(nPos);
-        if(nuc == majorAllele) {
-            cMajorAllele++;
-        } else if (nuc == minorAllele) {
-            cMinorAllele++;
-        }
-    }
+    // the counts of the variations are in the pileup of the contig
+    const RunParameters& parameters = _pContig->getParameters();
+    Pileup* pPileup = _pContig->getPileup();
+    int cMajorAllele = pPileup->getGroupCount(nPos, _name, parameters.nuc2int(majorAllele));
+    int cMinorAllele = (minorAllele == majorAllele) ? 0 : pPileup->getGroupCount(nPos, _name, parameters.nuc2int(minorAllele));
 
     csv << majorAllele << ":" << cMajorAllele << "/" << minorAllele << ":" << cMinorAllele;
 
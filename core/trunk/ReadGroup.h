@@ -14,6 +14,11 @@ class ReadGroup
 public:
     ReadGroup(string name, Contig* pContig);
 
+    // allocated in the arena of the contig: new (pContig) ReadGroup(...)
+    static void* operator new(size_t size, Contig* pContig);
+    static void operator delete(void* pMemory, Contig* pContig);
+
+
     void addRead(SeqRead*);
     void addReads(list<SeqRead*>&);
     string toCSV(int nPos, char majorAllele, char minorAllele);
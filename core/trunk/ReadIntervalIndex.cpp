@@ -0,0 +1,132 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include "SeqRead.h"
+#include "ReadIntervalIndex.h"
+
+using namespace std;
+
+ReadIntervalIndex::ReadIntervalIndex(const list<SeqRead*>& reads) :
+	_reads(reads.begin(), reads.end()), _maxLevel(-1)
+{
+	_intervals.reserve(_reads.size());
+	for(size_t iRead = 0; iRead < _reads.size(); iRead++) {
+		SeqRead* pRead = _reads[iRead];
+		Interval interval;
+		interval.start = pRead->getStartPosition() + pRead->getClippedsequenceStart();
+		interval.end = pRead->getStartPosition() + pRead->getClippedsequenceEnd();
+		interval.maxEnd = interval.end;
+		interval.iRead = iRead;
+		if(interval.start <= interval.end) {
+			_intervals.push_back(interval);
+		}
+	}
+
+	sort(_intervals.begin(), _intervals.end(), compareIntervals);
+	buildTree();
+}
+
+ReadIntervalIndex::~ReadIntervalIndex(void)
+{
+}
+
+bool ReadIntervalIndex::compareIntervals(const Interval& i1, const Interval& i2) {
+	return i1.start < i2.start || (i1.start == i2.start && i1.iRead < i2.iRead);
+}
+
+// set the largest end of every subtree, level by level. The last node of a
+// level may have a right child beyond the array, that child takes the largest
+// end of the nodes that do exist.
+void ReadIntervalIndex::buildTree() {
+	int n = _intervals.size();
+	if(n == 0) {
+		return;
+	}
+
+	int iLast = 0;
+	int lastMaxEnd = 0;
+	for(int i = 0; i < n; i += 2) {
+		iLast = i;
+		lastMaxEnd = _intervals[i].maxEnd;
+	}
+
+	int level;
+	for(level = 1; (1 << level) <= n; level++) {
+		int half = 1 << (level - 1);
+		for(int i = (half << 1) - 1; i < n; i += half << 2) {
+			int leftEnd = _intervals[i - half].maxEnd;
+			int rightEnd = (i + half < n) ? _intervals[i + half].maxEnd : lastMaxEnd;
+			_intervals[i].maxEnd = max(_intervals[i].end, max(leftEnd, rightEnd));
+		}
+
+		iLast = ((iLast >> level) & 1) ? iLast - half : iLast + half;
+		if(iLast < n) {
+			lastMaxEnd = max(lastMaxEnd, _intervals[iLast].maxEnd);
+		}
+	}
+	_maxLevel = level - 1;
+}
+
+// the indices in the reads list of the reads that overlap the inclusive range
+// start..end, in the order of the list
+void ReadIntervalIndex::findOverlapping(int start, int end, vector<int>& readIndices) {
+	readIndices.clear();
+	if(_maxLevel < 0) {
+		return;
+	}
+
+	int n = _intervals.size();
+	vector<Node> stack;
+	Node root = { _maxLevel, (1 << _maxLevel) - 1, false };
+	stack.push_back(root);
+	while(!stack.empty()) {
+		Node node = stack.back();
+		stack.pop_back();
+
+		if(node.level <= 3) {
+			// small subtree, scan it
+			int first = node.i >> node.level << node.level;
+			int last = min(n, first + (1 << (node.level + 1)) - 1);
+			for(int i = first; i < last && _intervals[i].start <= end; i++) {
+				if(_intervals[i].end >= start) {
+					readIndices.push_back(_intervals[i].iRead);
+				}
+			}
+		} else if(!node.bLeftDone) {
+			// the node itself and its right subtree come after the left subtree
+			int left = node.i - (1 << (node.level - 1));
+			node.bLeftDone = true;
+			stack.push_back(node);
+			if(left >= n || _intervals[left].maxEnd >= start) {
+				Node child = { node.level - 1, left, false };
+				stack.push_back(child);
+			}
+		} else if(node.i < n && _intervals[node.i].start <= end) {
+			if(_intervals[node.i].end >= start) {
+				readIndices.push_back(_intervals[node.i].iRead);
+			}
+			Node child = { node.level - 1, node.i + (1 << (node.level - 1)), false };
+			stack.push_back(child);
+		}
+	}
+
+	sort(readIndices.begin(), readIndices.end());
+}
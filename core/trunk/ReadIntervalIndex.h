@@ -0,0 +1,70 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __READINTERVALINDEX_H__
+#define __READINTERVALINDEX_H__
+
+#include <vector>
+#include <list>
+
+class SeqRead;
+
+using namespace std;
+
+// interval index over the clipped parts of the reads of a contig, to find the
+// reads that have a nucleotide at a position without a walk over all reads.
+//
+// An implicit augmented interval tree: the intervals are sorted on their start
+// and the array index is the in-order position in a binary tree. The node at
+// index i is at level k when i has k trailing 1 bits, and keeps the largest end
+// of its subtree. A query only descends into subtrees that can overlap.
+class ReadIntervalIndex
+{
+public:
+	ReadIntervalIndex(const list<SeqRead*>& reads);
+	~ReadIntervalIndex(void);
+
+	void findOverlapping(int start, int end, vector<int>& readIndices);
+	SeqRead* getRead(int iRead)		{ return _reads[iRead]; }
+
+private:
+	struct Interval {
+		int		start;
+		int		end;		// inclusive
+		int		maxEnd;		// largest end in the subtree
+		int		iRead;		// index in the reads list
+	};
+
+	struct Node {
+		int		level;
+		int		i;
+		bool	bLeftDone;
+	};
+
+	static bool compareIntervals(const Interval& i1, const Interval& i2);
+	void buildTree();
+
+private:
+	vector<SeqRead*>	_reads;
+	vector<Interval>	_intervals;
+	int					_maxLevel;
+};
+
+#endif
@@ -0,0 +1,247 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <QMutexLocker>
+#include "Logger.h"
+#include "CompressedFile.h"
+#include "ReferenceFile.h"
+
+using namespace std;
+
+ReferenceFile::ReferenceFile(const string& filename): _filename(filename), _pMap(NULL), _mapSize(0)
+{
+}
+
+ReferenceFile::~ReferenceFile(void)
+{
+#ifndef _WIN32
+	if(_mapSize > 0) {
+		munmap(const_cast<char*>(_pMap), _mapSize);
+	}
+#endif
+}
+
+bool ReferenceFile::openFile() {
+	if(CompressedFile::detectCompression(_filename) != COMPRESSION_NONE) {
+		Logger::getLogger()->log(QSNP_ERROR, "the reference file has to be uncompressed: " + _filename);
+		return false;
+	}
+
+	if(!mapFile()) {
+		_ifFile.open(_filename.c_str(), ios::in | ios::binary);
+		if(_ifFile.fail()) {
+			Logger::getLogger()->log(QSNP_ERROR, "could not open reference file: " + _filename);
+			return false;
+		}
+	}
+
+	if(!loadIndex(_filename + ".fai")) {
+		Logger::getLogger()->log(QSNP_INFO, "no FASTA index for the reference, scanning: " + _filename);
+		if(!buildIndex()) {
+			return false;
+		}
+	}
+
+	stringstream ssCount;
+	ssCount << _sequences.size();
+	Logger::getLogger()->log(QSNP_INFO, "using " + ssCount.str() + " reference sequences from: " + _filename);
+	return true;
+}
+
+// map the whole file into memory, returns false if that is not possible
+bool ReferenceFile::mapFile() {
+#ifdef _WIN32
+	return false;
+#else
+	int fd = open(_filename.c_str(), O_RDONLY);
+	if(fd == -1) {
+		return false;
+	}
+
+	struct stat fileStat;
+	if(fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode) || fileStat.st_size == 0) {
+		close(fd);
+		return false;
+	}
+
+	_mapSize = fileStat.st_size;
+	void* pMap = mmap(NULL, _mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(pMap == MAP_FAILED) {
+		_mapSize = 0;
+		return false;
+	}
+
+	_pMap = static_cast<const char*>(pMap);
+	return true;
+#endif
+}
+
+// the lines of a .fai file: name, length, offset, bases per line and bytes per line
+bool ReferenceFile::loadIndex(const string& indexFilename) {
+	ifstream ifIndex(indexFilename.c_str(), ios::in);
+	if(ifIndex.fail()) {
+		return false;
+	}
+
+	_sequences.clear();
+	_sequenceMap.clear();
+
+	string line;
+	while(getline(ifIndex, line)) {
+		if(line.empty()) {
+			continue;
+		}
+
+		ReferenceSequence sequence;
+		stringstream ssLine(line);
+		if(!getline(ssLine, sequence.name, '\t') || !(ssLine >> sequence.length >> sequence.offset >> sequence.lineBases >> sequence.lineWidth)
+		   || sequence.length < 0 || sequence.offset < 0 || (sequence.length > 0 && (sequence.lineBases <= 0 || sequence.lineWidth < sequence.lineBases))) {
+			Logger::getLogger()->log(QSNP_WARNING, "ignoring invalid FASTA index: " + indexFilename);
+			_sequences.clear();
+			_sequenceMap.clear();
+			return false;
+		}
+
+		_sequenceMap[sequence.name] = _sequences.size();
+		_sequences.push_back(sequence);
+	}
+
+	Logger::getLogger()->log(QSNP_INFO, "using FASTA index: " + indexFilename);
+	return true;
+}
+
+// find the sequences in the file itself, the way samtools faidx does: the
+// name is the header up to the first white space and all lines of a sequence
+// but the last one have the same length
+bool ReferenceFile::buildIndex() {
+	_sequences.clear();
+	_sequenceMap.clear();
+
+	ifstream ifFasta(_filename.c_str(), ios::in | ios::binary);
+	if(ifFasta.fail()) {
+		Logger::getLogger()->log(QSNP_ERROR, "could not open reference file: " + _filename);
+		return false;
+	}
+
+	ReferenceSequence* pSequence = NULL;
+	bool bShortLine = false;
+	int64_t offset = 0;
+	string line;
+	while(getline(ifFasta, line)) {
+		int64_t lineOffset = offset;
+		int lineWidth = line.size() + (ifFasta.eof() ? 0 : 1);
+		offset += lineWidth;
+		if(!line.empty() && line[line.size() - 1] == '\r') {
+			line.erase(line.size() - 1);
+		}
+
+		if(!line.empty() && line[0] == '>') {
+			ReferenceSequence sequence;
+			sequence.name = line.substr(1, line.find_first_of(" \t") - 1);
+			sequence.length = 0;
+			sequence.offset = offset;
+			sequence.lineBases = 0;
+			sequence.lineWidth = 0;
+			_sequenceMap[sequence.name] = _sequences.size();
+			_sequences.push_back(sequence);
+			pSequence = &_sequences.back();
+			bShortLine = false;
+			continue;
+		}
+
+		if(pSequence == NULL || line.empty()) {
+			continue;
+		}
+
+		if(pSequence->length == 0) {
+			pSequence->offset = lineOffset;
+			pSequence->lineBases = line.size();
+			pSequence->lineWidth = lineWidth;
+		} else if(bShortLine || static_cast<int>(line.size()) > pSequence->lineBases) {
+			Logger::getLogger()->log(QSNP_ERROR, "different line lengths in reference sequence " + pSequence->name + ", create an index with samtools faidx: " + _filename);
+			return false;
+		}
+
+		bShortLine = static_cast<int>(line.size()) < pSequence->lineBases;
+		pSequence->length += line.size();
+	}
+
+	return true;
+}
+
+// copy the bytes of the file from offset, from the mapped file or with the stream
+bool ReferenceFile::readBases(int64_t offset, int64_t length, char* bases) {
+	if(_pMap != NULL) {
+		if(offset + length > static_cast<int64_t>(_mapSize)) {
+			return false;
+		}
+		memcpy(bases, _pMap + offset, length);
+		return true;
+	}
+
+	QMutexLocker locker(&_mutex);
+	_ifFile.clear();
+	_ifFile.seekg(offset);
+	_ifFile.read(bases, length);
+	return _ifFile.gcount() == length;
+}
+
+// the bases of a reference sequence in upper case, false if the reference
+// does not have the sequence
+bool ReferenceFile::getSequence(const string& name, string& sequence) {
+	map<string, int>::const_iterator itSequence = _sequenceMap.find(name);
+	if(itSequence == _sequenceMap.end()) {
+		return false;
+	}
+
+	const ReferenceSequence& reference = _sequences[itSequence->second];
+	sequence.resize(reference.length);
+
+	// the sequence is copied a line at a time, leaving out the line ends
+	int64_t cCopied = 0;
+	int64_t offset = reference.offset;
+	while(cCopied < reference.length) {
+		int64_t cBases = min(static_cast<int64_t>(reference.lineBases), reference.length - cCopied);
+		if(!readBases(offset, cBases, &sequence[cCopied])) {
+			Logger::getLogger()->log(QSNP_ERROR, "reference sequence " + name + " is beyond the end of: " + _filename);
+			sequence.clear();
+			return false;
+		}
+		cCopied += cBases;
+		offset += reference.lineWidth;
+	}
+
+	for(string::iterator itBase = sequence.begin(); itBase != sequence.end(); itBase++) {
+		*itBase = toupper(static_cast<unsigned char>(*itBase));
+	}
+
+	return true;
+}
@@ -0,0 +1,79 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __REFERENCEFILE_H__
+#define __REFERENCEFILE_H__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <stdint.h>
+#include <QMutex>
+
+using namespace std;
+
+// a sequence of a FASTA index (.fai): the file offset of the first base and
+// the number of bases and bytes of every line
+struct ReferenceSequence {
+	string		name;
+	int64_t		length;
+	int64_t		offset;
+	int			lineBases;
+	int			lineWidth;
+};
+
+// reference sequences in an uncompressed FASTA file. The positions of the
+// sequences are taken from the .fai index next to the file (as written by
+// samtools faidx) or found with a scan of the file when there is no index.
+// The file is memory mapped, so a sequence is copied from the page cache
+// without reading the rest of the file. The sequences can be fetched from
+// several threads at once.
+class ReferenceFile
+{
+public:
+	ReferenceFile(const string& filename);
+	~ReferenceFile(void);
+
+	bool openFile();
+	bool hasSequence(const string& name)	{ return _sequenceMap.count(name) == 1; }
+	bool getSequence(const string& name, string& sequence);
+
+private:
+	bool mapFile();
+	bool loadIndex(const string& indexFilename);
+	bool buildIndex();
+	bool readBases(int64_t offset, int64_t length, char* bases);
+
+private:
+	string						_filename;
+	vector<ReferenceSequence>	_sequences;
+	map<string, int>			_sequenceMap;
+
+	// memory mapped file
+	const char*					_pMap;
+	size_t						_mapSize;
+
+	// the file is read with a stream when it cannot be mapped
+	ifstream					_ifFile;
+	QMutex						_mutex;
+};
+
+#endif
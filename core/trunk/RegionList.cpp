@@ -0,0 +1,113 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <fstream>
+#include <sstream>
+#include <climits>
+#include "Logger.h"
+#include "RegionList.h"
+
+using namespace std;
+
+RegionList::RegionList(void): _pLastRegions(NULL)
+{
+}
+
+RegionList::~RegionList(void)
+{
+}
+
+// lines with a name, a start and an end are BED regions (zero-based, end
+// exclusive), lines with only a name select the whole contig
+bool RegionList::load(const string& filename) {
+	ifstream ifRegions(filename.c_str(), ios::in);
+	if(ifRegions.fail()) {
+		Logger::getLogger()->log(QSNP_ERROR, "could not open regions file: " + filename);
+		return false;
+	}
+
+	_contigNames.clear();
+	_regions.clear();
+	_lastContigName.clear();
+	_pLastRegions = NULL;
+
+	string line;
+	while(getline(ifRegions, line)) {
+		if(line.empty() || line[0] == '#' || line.compare(0, 5, "track") == 0 || line.compare(0, 7, "browser") == 0) {
+			continue;
+		}
+
+		string name;
+		long start, end;
+		stringstream ssLine(line);
+		if(!(ssLine >> name)) {
+			continue;
+		}
+
+		if(ssLine >> start >> end) {
+			if(start < 0 || end <= start) {
+				Logger::getLogger()->log(QSNP_ERROR, "invalid region in file " + filename + ": " + line);
+				return false;
+			}
+			addRegion(name, start + 1, end > INT_MAX ? INT_MAX : end);
+		} else {
+			addRegion(name, 1, INT_MAX);
+		}
+	}
+
+	Logger::getLogger()->log(QSNP_INFO, "restricting the analysis to the regions in: " + filename);
+	return true;
+}
+
+void RegionList::addRegion(const string& contigName, int start, int end) {
+	map<string, vector<Region> >::iterator itRegions = _regions.find(contigName);
+	if(itRegions == _regions.end()) {
+		_contigNames.push_back(contigName);
+		itRegions = _regions.insert(make_pair(contigName, vector<Region>())).first;
+	}
+
+	Region region = {start, end};
+	itRegions->second.push_back(region);
+}
+
+bool RegionList::overlaps(const string& contigName, int start, int end) {
+	return overlaps(contigName.data(), contigName.size(), start, end);
+}
+
+// true if the range from start to end overlaps one of the regions of the contig
+bool RegionList::overlaps(const char* contigName, int nameLength, int start, int end) {
+	if(_pLastRegions == NULL || _lastContigName.compare(0, string::npos, contigName, nameLength) != 0) {
+		_lastContigName.assign(contigName, nameLength);
+		map<string, vector<Region> >::iterator itRegions = _regions.find(_lastContigName);
+		_pLastRegions = (itRegions == _regions.end()) ? NULL : &itRegions->second;
+		if(_pLastRegions == NULL) {
+			return false;
+		}
+	}
+
+	vector<Region>::const_iterator itRegion;
+	for(itRegion = _pLastRegions->begin(); itRegion != _pLastRegions->end(); itRegion++) {
+		if(start <= itRegion->end && end >= itRegion->start) {
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,61 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __REGIONLIST_H__
+#define __REGIONLIST_H__
+
+#include <string>
+#include <vector>
+#include <map>
+
+using namespace std;
+
+// a target range on a contig, one-based and inclusive
+struct Region {
+	int		start;
+	int		end;
+};
+
+// the target contigs and ranges of a restricted run, read from a BED file
+// or from a list with a contig name per line
+class RegionList
+{
+public:
+	RegionList(void);
+	~RegionList(void);
+
+	bool load(const string& filename);
+	const vector<string>& getContigNames() { return _contigNames; }
+	bool overlaps(const char* contigName, int nameLength, int start, int end);
+	bool overlaps(const string& contigName, int start, int end);
+
+private:
+	void addRegion(const string& contigName, int start, int end);
+
+private:
+	vector<string>					_contigNames;
+	map<string, vector<Region> >	_regions;
+
+	// regions of the contig of the previous lookup
+	string							_lastContigName;
+	const vector<Region>*			_pLastRegions;
+};
+
+#endif
@@ -0,0 +1,60 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Configuration.h"
+#include "RunParameters.h"
+
+using namespace std;
+
+RunParameters::RunParameters(Configuration* pConfig)
+{
+	cNucs = pConfig->getNumberOfNucs();
+	for(int iNuc = 0; iNuc < cNucs; iNuc++) {
+		nucs += pConfig->int2nuc(iNuc);
+	}
+
+	// the nucleotides are all in the ASCII range
+	for(int i = 0; i < 256; i++) {
+		nucIndex[i] = (i < 128) ? pConfig->nuc2int(static_cast<char>(i)) : -1;
+	}
+
+	minSNPQualityScore				= pConfig->getInt("minSNPQualityScore");
+	minNumberOfHighQualityReads		= pConfig->getInt("minNumberOfHighQualityReads");
+	lowQualityRegion5prime			= pConfig->getInt("lowQualityRegion5prime");
+	lowQualityRegion3prime			= pConfig->getInt("lowQualityRegion3prime");
+	lowQualityRegion3primePerc		= pConfig->getDouble("lowQualityRegion3primePerc");
+
+	minimalNumberOfReadsPerAllele	= pConfig->getInt("minimalNumberOfReadsPerAllele");
+	minimalNumberOfReadsPerAllelep	= pConfig->getDouble("minimalNumberOfReadsPerAllelep");
+	minimalConfidenceScore			= pConfig->getInt("minimalConfidenceScore");
+	indelLowQuality					= pConfig->getBool("indelLowQuality");
+	lowComplexityLowQuality			= pConfig->getBool("lowComplexityLowQuality");
+	lowComplexityRegionSize			= pConfig->getInt("lowComplexityRegionSize");
+	lowComplexityRepeatCount		= pConfig->getInt("lowComplexityRepeatCount");
+	weightHighQualityRegion			= pConfig->getDouble("weightHighQualityRegion");
+	weightLowQualityRegion			= pConfig->getDouble("weightLowQualityRegion");
+	alleleMajorityThreshold			= pConfig->getDouble("alleleMajorityThreshold");
+
+	similarityPerPolymorphicSite	= pConfig->getDouble("similarityPerPolymorphicSite");
+	similarityAllPolymorphicSites	= pConfig->getDouble("similarityAllPolymorphicSites");
+	minimalNumberOfReadsPerHaploType	= pConfig->getInt("minimalNumberOfReadsPerHaploType");
+	maxNumberOfSNPsInFlanks			= pConfig->getInt("maxNumberOfSNPsInFlanks");
+	onlyReliableMarkers				= pConfig->getBool("onlyReliableMarkers");
+}
@@ -0,0 +1,74 @@
+/*
+* This File is part of QualitySNP; a program to detect Single Nucleotide Variations
+* https://trac.nbic.nl/qualitysnp/
+*
+*   Copyright (C) 2012 Harm Nijveen
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __RUNPARAMETERS_H__
+#define __RUNPARAMETERS_H__
+
+#include <string>
+
+class Configuration;
+
+using namespace std;
+
+// the analysis settings of the configuration as typed fields, for the loops
+// over the reads and columns of a contig that would otherwise look up the
+// same keys in the configuration maps over and over. A contig takes a copy
+// when it is created and hands it to its reads, variations and haplotypes, so
+// the analysis of a contig does not change when the configuration does.
+struct RunParameters
+{
+	RunParameters(Configuration* pConfig);
+
+	int nuc2int(char nuc) const		{ return nucIndex[static_cast<unsigned char>(nuc)]; }
+	char int2nuc(int iNuc) const	{ return (iNuc >= 0 && iNuc < cNucs) ? nucs[iNuc] : 'N'; }
+
+	// nucleotides
+	int		cNucs;
+	string	nucs;
+	int		nucIndex[256];
+
+	// quality
+	int		minSNPQualityScore;
+	int		minNumberOfHighQualityReads;
+	int		lowQualityRegion5prime;
+	int		lowQualityRegion3prime;
+	double	lowQualityRegion3primePerc;
+
+	// variations
+	int		minimalNumberOfReadsPerAllele;
+	double	minimalNumberOfReadsPerAllelep;
+	int		minimalConfidenceScore;
+	bool	indelLowQuality;
+	bool	lowComplexityLowQuality;
+	int		lowComplexityRegionSize;
+	int		lowComplexityRepeatCount;
+	double	weightHighQualityRegion;
+	double	weightLowQualityRegion;
+	double	alleleMajorityThreshold;
+
+	// haplotypes and markers
+	double	similarityPerPolymorphicSite;
+	double	similarityAllPolymorphicSites;
+	int		minimalNumberOfReadsPerHaploType;
+	int		maxNumberOfSNPsInFlanks;
+	bool	onlyReliableMarkers;
+};
+
+#endif
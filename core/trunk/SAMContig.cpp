@@ -19,15 +19,40 @@
 */
 
 #include <list>
+#include <vector>
+#include <algorithm>
 #include "Logger.h"
 #include "SeqRead.h"
 #include "Contig.h"
 #include "SAMRead.h"
+#include "Pileup.h"
+#include "ReferenceFile.h"
 #include "SAMContig.h"
 
 using namespace std;
 
-SAMContig::SAMContig()
+// a read in the name table of mergeReadPairs
+struct PairSlot {
+	PairSlot(): hash(0), pRead(NULL) {}
+
+	uint32_t	hash;
+	SAMRead*	pRead;
+};
+
+// FNV-1a hash of a read name
+static uint32_t hashName(const string& name) {
+	uint32_t hash = 2166136261u;
+	for(string::const_iterator itChar = name.begin(); itChar != name.end(); itChar++) {
+		hash = (hash ^ static_cast<unsigned char>(*itChar)) * 16777619u;
+	}
+	return hash;
+}
+
+static bool compareInsertions(const InsertionColumns& insertion1, const InsertionColumns& insertion2) {
+	return insertion1.position < insertion2.position;
+}
+
+SAMContig::SAMContig(): _cInsertionColumns(0)
 {
 }
 
@@ -38,6 +63,8 @@ SAMContig::~SAMContig() {
 }
 
 // construct the reference sequence from the information in the individual reads
+// the nucleotides of all reads are counted per column in a pileup, which takes
+// the majority nucleotide of every column
 bool SAMContig::constructReferenceSequence() {
     Logger::getLogger()->log(QSNP_INFO, "construction reference sequence for: " + _name);
 	list<SAMRead*>::iterator it;
@@ -47,120 +74,141 @@ bool SAMContig::constructReferenceSequence() {
 		length = max(length, readLastPos);
 	}
 
-	_sequence.reserve(length);
-
-	Configuration* pConfig = Configuration::getConfig();
-	int nDifferentNucs = pConfig->getNumberOfNucs(); // for readability
-	int* nucCount = new int[nDifferentNucs]; // keep a count of all nucleotides
+	Pileup pileup(length);
+	for ( it=_reads.begin(); it != _reads.end(); it++) {
+		if((*it)->getStartPosition() >= 0) {
+			pileup.addRead((*it)->getStartPosition(), (*it)->getSequence());
+		}
+	}
 
-    vector< list<SAMRead*> > startPosReads;
-    startPosReads.resize(length + 1);
-    for ( it=_reads.begin(); it != _reads.end(); it++) {
-        startPosReads[(*it)->getStartPosition() + 1].push_back(*it);
-    }
+	_sequence = pileup.consensus();
 
-    list<SAMRead*> reads;
-	for(unsigned int pos = 1; pos <= length; pos++) {
-        while(!startPosReads[pos].empty()) {
-            reads.push_back(startPosReads[pos].front());
-            startPosReads[pos].pop_front();
-        }
+	return true;
+}
 
-		for(int iNuc= 0; iNuc < nDifferentNucs; iNuc++) {
-			nucCount[iNuc] = 0;
-		}
+// take the sequence of the contig from the reference instead, with gaps in
+// the insertion columns of the reads. Returns false if the reference does
+// not have the contig.
+bool SAMContig::loadReferenceSequence(ReferenceFile* pReference) {
+	string reference;
+	if(_name.empty()) {
+		return false;
+	}
+	if(!pReference->getSequence(_name, reference)) {
+		Logger::getLogger()->log(QSNP_WARNING, "contig " + _name + " is not in the reference, constructing its sequence from the reads");
+		return false;
+	}
+	Logger::getLogger()->log(QSNP_INFO, "taking the reference sequence from the reference file for: " + _name);
 
-		bool bInformative = false;
-        for ( it=reads.begin(); it != reads.end(); ) {
-            if(pos > (*it)->getLastPosition()) {
-                it = reads.erase(it);
-            } else {
-                char readNucl =(*it)->getNucleotideAt(pos);
-                int iNuc = pConfig->nuc2int(readNucl);
-                if(iNuc != -1) {
-                    nucCount[iNuc]++;
-                    bInformative = true;
-                }
-                it++;
-            }
-		}
+	unsigned int length = 0;
+	for (list<SAMRead*>::iterator it=_reads.begin(); it != _reads.end(); it++) {
+		unsigned int readLastPos = (*it)->getLastPosition();
+		length = max(length, readLastPos);
+	}
 
-        char nucl = 'N';
+	// positions are one-based, column 0 is in front of the reference
+	int lastPosition = reference.size();
+	if(!_insertions.empty()) {
+		lastPosition = max(lastPosition, _insertions.back().position);
+	}
 
-		if(bInformative) {
-			int iMaxNuc = 0;
-			for(int iNuc= 1; iNuc < nDifferentNucs; iNuc++) {
-				if(nucCount[iNuc] > nucCount[iMaxNuc]) {
-					iMaxNuc = iNuc;
-				}
-			}
-			nucl = pConfig->int2nuc(iMaxNuc);
+	_sequence.clear();
+	_sequence.reserve(max(static_cast<size_t>(length), lastPosition + 1 + static_cast<size_t>(_cInsertionColumns)));
+	vector<InsertionColumns>::const_iterator itInsertions = _insertions.begin();
+	for(int position = 0; position <= lastPosition; position++) {
+		if(itInsertions != _insertions.end() && itInsertions->position == position) {
+			_sequence.append(itInsertions->length, '*');
+			itInsertions++;
 		}
-
-		_sequence += nucl;
+		_sequence += (position > 0 && position <= static_cast<int>(reference.size())) ? reference[position - 1] : 'N';
 	}
 
-	delete[] nucCount;
+	// reads running past the end of the reference
+	if(_sequence.size() < length) {
+		_sequence.resize(length, 'N');
+	}
 
 	return true;
 }
 
+// make room in all reads for the insertions of the other reads. The insertion
+// columns of the contig are collected once from the reads with insertions,
+// then every read is padded to them in a single pass.
 void SAMContig::stretchReads() {
     Logger::getLogger()->log(QSNP_INFO, "SAMContig: stretching reads to include insertions");
     list<SAMRead*>::iterator it;
-    unsigned int pos = 1;
 
-    list<SAMRead*> reads = _reads;
-    list<SAMRead*> readsWithInsertions;
+    vector<InsertionColumns>& insertions = _insertions;
+    insertions.clear();
+    _cInsertionColumns = 0;
     for ( it=_reads.begin(); it != _reads.end(); it++) {
         if((*it)->hasInsertions()) {
-            readsWithInsertions.push_back(*it);
+            (*it)->collectInsertions(insertions);
         }
     }
 
-    while (!readsWithInsertions.empty()) {
-        bool bInsert = false;
-        it = readsWithInsertions.begin();
-        while(it != readsWithInsertions.end() && !bInsert) {
-            char operation =(*it)->getOperationAt(pos);
-            if(operation == 'I') {
-                bInsert = true;
-            }
-            if(operation == '>') {
-                it = readsWithInsertions.erase(it);
-            } else {
-                it++;
-            }
+    if(insertions.empty()) {
+        return;
+    }
+
+    // keep the longest insertion at every position
+    sort(insertions.begin(), insertions.end(), compareInsertions);
+    size_t cPositions = 0;
+    int cInsertionColumns = 0;
+    for(size_t i = 0; i < insertions.size(); i++) {
+        if(cPositions > 0 && insertions[cPositions - 1].position == insertions[i].position) {
+            insertions[cPositions - 1].length = max(insertions[cPositions - 1].length, insertions[i].length);
+            continue;
         }
-        if (bInsert) {
-            for ( it=reads.begin(); it != reads.end();) {
-                bool bInside = (*it)->insertGapAt(pos);
-                if(bInside) {
-                    it++;
-                } else {
-                    it = reads.erase(it);
-                }
-            }
+        if(cPositions > 0) {
+            cInsertionColumns += insertions[cPositions - 1].length;
         }
-        pos++;
+        insertions[cPositions] = insertions[i];
+        insertions[cPositions].cBefore = cInsertionColumns;
+        cPositions++;
+    }
+    cInsertionColumns += insertions[cPositions - 1].length;
+    insertions.resize(cPositions);
+    _cInsertionColumns = cInsertionColumns;
+
+    for ( it=_reads.begin(); it != _reads.end(); it++) {
+        (*it)->padInsertions(insertions, cInsertionColumns);
     }
 }
 
+// merge the mates of read pairs, which have the same name. The reads are
+// looked up by name in an open addressing table that refers to the names
+// of the reads themselves, with the hash of every name stored in its slot.
 void SAMContig::mergeReadPairs() {
     Logger::getLogger()->log(QSNP_INFO, "SAMContig: merging read pairs");
 	list<SAMRead*>::iterator it;
-	
-	map<string, list<SAMRead*>::iterator> readMap;
+
+	// at most half of the slots are used
+	size_t cReads = _reads.size();
+	size_t cSlots = 16;
+	while(cSlots < 2 * cReads) {
+		cSlots *= 2;
+	}
+	vector<PairSlot> slots(cSlots);
+	size_t mask = cSlots - 1;
+
 	for ( it=_reads.begin(); it != _reads.end();) {
-		string readName = (*it)->getName();
-		
-		if(readMap.count(readName) == 1) {
+		const string& readName = (*it)->getName();
+		uint32_t hash = hashName(readName);
+
+		size_t iSlot = hash & mask;
+		while(slots[iSlot].pRead != NULL && (slots[iSlot].hash != hash || slots[iSlot].pRead->getName() != readName)) {
+			iSlot = (iSlot + 1) & mask;
+		}
+
+		if(slots[iSlot].pRead != NULL) {
             Logger::getLogger()->log(QSNP_DEBUG, "Merging read pair with name: " + readName);
-			(*readMap[readName])->merge(*it);
+			slots[iSlot].pRead->merge(*it);
 			delete *it;
 			it = _reads.erase(it);
 		} else {
-			readMap[readName] = it;
+			slots[iSlot].hash = hash;
+			slots[iSlot].pRead = *it;
 			++it;
 		}
 	}
@@ -172,11 +220,13 @@ Contig* SAMContig::toContig() {
 	}
     Logger::getLogger()->log(QSNP_INFO, "SAMContig: converting to Contig");
 
+	// the sequences are handed over and every read is freed right after its
+	// conversion, so the reads are not held twice
 	Contig* pContig = new Contig(_name);
-	pContig->setSequence(_sequence);
-	for(list<SAMRead*>::iterator itRead = _reads.begin(); itRead != _reads.end(); itRead++) {
-		SeqRead* pSeqRead = (*itRead)->toSeqRead();
-		pSeqRead->setContig(pContig);
+	pContig->takeSequence(_sequence);
+	for(list<SAMRead*>::iterator itRead = _reads.begin(); itRead != _reads.end(); itRead = _reads.erase(itRead)) {
+		SeqRead* pSeqRead = (*itRead)->toSeqRead(pContig);
+		delete *itRead;
 		pContig->addRead(pSeqRead);
 	}
 	
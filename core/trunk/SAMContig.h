@@ -23,9 +23,11 @@
 
 #include <string>
 #include <list>
+#include <vector>
 #include "ContigFile.h"
+#include "SAMRead.h"
 
-class SAMRead;
+class ReferenceFile;
 
 using namespace std;
 
@@ -40,6 +42,7 @@ public:
 	void addRead(SAMRead* pRead) { _reads.push_back(pRead); }
 	const string& getName() { return _name; }
 	bool constructReferenceSequence();
+	bool loadReferenceSequence(ReferenceFile* pReference);
 	void stretchReads();
 	void mergeReadPairs();
 	Contig* toContig();
@@ -48,6 +51,8 @@ private:
 	string					_name;
 	string					_sequence;
 	list<SAMRead*>			_reads;
+	vector<InsertionColumns>	_insertions;
+	int						_cInsertionColumns;
 };
 
 #endif
@@ -19,9 +19,12 @@
 */
 
 #include <iostream>
-#include <sstream>
+#include <cstring>
 #include <list>
 #include <map>
+#include <sstream>
+#include <algorithm>
+#include <QThread>
 #include "HaploType.h"
 #include "SeqRead.h"
 #include "Contig.h"
@@ -29,84 +32,147 @@
 #include "ACEFile.h"
 #include "SAMRead.h"
 #include "SAMContig.h"
+#include "RegionList.h"
+#include "ReferenceFile.h"
 #include "SAMFile.h"
 
-template <class T>
-bool from_string(T& t, const std::string& s, std::ios_base& (*f)(std::ios_base&)) {
-  std::istringstream iss(s);
-  return !(iss >> f >> t).fail();
+// size of the byte ranges handed to the parser threads
+static const uint64_t SAM_RANGE_SIZE = 1 << 22;
+
+// number of ranges each parser thread may work ahead of the reader
+static const int SAM_RANGES_AHEAD = 2;
+
+class SAMParser : public QThread
+{
+public:
+	SAMParser(SAMFile* pFile): _pFile(pFile) {}
+
+protected:
+	void run() { _pFile->runParser(); }
+
+private:
+	SAMFile* _pFile;
+};
+
+// parse a decimal integer in place, the whole field has to be a number
+static bool parseInt(const char* field, int length, int& value) {
+	const char* p = field;
+	const char* end = field + length;
+	bool bNegative = false;
+
+	if(p < end && (*p == '-' || *p == '+')) {
+		bNegative = (*p == '-');
+		p++;
+	}
+
+	if(p == end) {
+		return false;
+	}
+
+	int result = 0;
+	for(; p < end; p++) {
+		if(*p < '0' || *p > '9') {
+			return false;
+		}
+		result = result * 10 + (*p - '0');
+	}
+
+	value = bNegative ? -result : result;
+	return true;
 }
 
-SAMFile::SAMFile(const string& contigFilename): _contigFilename(contigFilename), _pRead(NULL), _cReads(-1)
+SAMFile::SAMFile(const string& contigFilename): _contigFilename(contigFilename), _lineReader(contigFilename),
+  _contigIndex(contigFilename), _pRegions(NULL), _pReference(NULL), _pRead(NULL), _cReads(-1), _cContigs(-1),
+  _includeFlags(Configuration::getConfig()->getInt("includeFlags")),
+  _excludeFlags(Configuration::getConfig()->getInt("excludeFlags")),
+  _minimalMappingQuality(Configuration::getConfig()->getInt("minimalMappingQuality")),
+  _bStdin(contigFilename == STDIN_FILENAME), _bGroupContigs(Configuration::getConfig()->getBool("groupContigs")),
+  _pGrouper(NULL), _bWarnedUnsorted(false), _cParseThreads(Configuration::getConfig()->getInt("parsingThreads")),
+  _nextRangeSequence(0), _nextTakeSequence(0), _nextRangeStart(0), _bAllRangesClaimed(false), _bParsedEOF(false), _bStopParsers(false)
 {
 }
 
 SAMFile::~SAMFile(void)
 {
+	stopParsers();
+	delete _pRead;
+	delete _pGrouper;
 }
 
 
 bool SAMFile::openFile() {
-	if(_ifSAMFile.is_open()) {
-		return true;
-	}
-
-	_ifSAMFile.open(_contigFilename.c_str(),ios::in);
-	if (_ifSAMFile.fail()) {
-		Logger::getLogger()->log(QSNP_ERROR, "could not open file: " + _contigFilename);
-		return false;
-	}
-
-    return true;
+	return _lineReader.openFile();
 }
 
 bool SAMFile::isValid() {
-	if(!openFile()) {
+	if(!_lineReader.rewind()) {
 		return false;
 	}
-		
-    _ifSAMFile.seekg (0, ios::beg);
 
 	int cLines = 0;
-	string line;
+	const char* line;
+	int length;
+	const char* fields[SAM_MANDATORY_FIELDS];
+	int lengths[SAM_MANDATORY_FIELDS];
 	bool foundAt = false;
 
-	// scan 100 lines to find a line starting with @ indicating a header line
-	while(cLines < 100 && getline(_ifSAMFile,line) && !foundAt) {
-		if (!emptyLine(line) && line[0] == '@') {
+	// scan 100 lines to find a line starting with @ indicating a header line,
+	// or an alignment line for SAM without a header, like samtools view writes.
+	// The lines stay in the buffer of the reader, so this works on a pipe too.
+	while(cLines < 100 && !foundAt && _lineReader.nextLine(line, length)) {
+		int nFlag, nStart;
+		if (length > 0 && line[0] == '@') {
             foundAt = true;
+		} else if(splitLine(line, length, fields, lengths) == SAM_MANDATORY_FIELDS
+				&& parseInt(fields[SAM_FLAG], lengths[SAM_FLAG], nFlag) && parseInt(fields[SAM_POS], lengths[SAM_POS], nStart)) {
+			foundAt = true;
 		}
 		cLines++;
 	}
 
-    _ifSAMFile.clear();	
-    _ifSAMFile.seekg (0, ios::beg);
+    _lineReader.rewind();
     return foundAt;
 }
 
 // return the next contig in the SAM file, or NULL if there are no more contigs
+// with more than one parsing thread a memory mapped file is parsed in parallel
 Contig* SAMFile::nextContig() {
     Logger::getLogger()->log(QSNP_INFO, "SAMFile::nextContig()");
     openFile();
-	string line;
 
+    // the contig index tells if the reads of a contig are together
+    if(_cReads == -1 && !_bStdin) {
+        collectStatistics();
+    }
+
+    if(_bGroupContigs) {
+        return readGroupedContig();
+    }
+
+    if(_cParseThreads > 1 && _lineReader.isMapped()) {
+        return takeParsedContig();
+    }
+
+    return readContig();
+}
+
+Contig* SAMFile::readContig() {
 	SAMContig contig;
-	Configuration* pConfig = Configuration::getConfig();
 
 	if(_pRead != NULL) {
 		contig.setName(_pRead->getContigName());
 		contig.addRead(_pRead);
+		_pRead = NULL;
 	}
 
-	int counter = 0;
-	while(getline(_ifSAMFile, line)) {
-		counter++;
-		if (!line.empty() && line[0] != '@') {
-            SAMRead* pRead = parseReadLine(line, false);
+	const char* line;
+	int length;
+	while(_lineReader.nextLine(line, length)) {
+		if (length > 0 && line[0] != '@') {
+            SAMRead* pRead = parseReadLine(line, length, false);
 			if (pRead != NULL) {
-				if (pRead->getMapQuality() < pConfig->getInt("minimalMappingQuality")) {
-					Logger::getLogger()->log(QSNP_INFO, "Skipping read (" + pRead->getName() + ") with low mapping quality");
-                    continue;
+				if(_bStdin) {
+					_cReads = max(_cReads, 0) + 1;
 				}
 				if(contig.getName().empty()) {
 					contig.setName(pRead->getContigName());
@@ -116,69 +182,522 @@ Contig* SAMFile::nextContig() {
 					contig.addRead(pRead);
 				} else {
 					_pRead = pRead;
-					contig.stretchReads();
-					contig.mergeReadPairs();
-					contig.constructReferenceSequence();
-					return contig.toContig();
+					if(_bStdin && !_finishedContigs.insert(contig.getName()).second && !_bWarnedUnsorted) {
+						Logger::getLogger()->log(QSNP_WARNING, "the reads of contig " + contig.getName() + " are not together, sort the input or use -groupContigs");
+						_bWarnedUnsorted = true;
+					}
+					return finishContig(contig);
 				}
 			}
 		}
 	}
 
-	_pRead = NULL;
-    contig.stretchReads();
+	return finishContig(contig);
+}
+
+Contig* SAMFile::finishContig(SAMContig& contig) {
+	contig.stretchReads();
 	contig.mergeReadPairs();
-	contig.constructReferenceSequence();
+	if(_pReference == NULL || !contig.loadReferenceSequence(_pReference)) {
+		contig.constructReferenceSequence();
+	}
 	return contig.toContig();
 }
 
-SAMRead* SAMFile::parseReadLine(const string& line, bool bCollectStatics) {
-//SPWG_7257172	35	Contig_23	1	60	19S80M	=	3	120	CATTTATCGCCTCAGAGTTCATGGCTATGAAACCAAAACAGAGAGTGTAGAAGATGAAAGCATGAGATGATGATATTTGAATTTGCTGCTTCATATTGT	GHIIGIIIIDIIIIIIGIIIGIIIIIIIIHIIIIIIIIIFIIIHIDGFIGFBIGHIDIIIIHIIBIFHHHGIHGHGIHBHFIHHGHEGDBEEGE>EC>C	NH:i:1
+// the first line at or after position where the reference changes, skipping
+// the rest of the contig that is running at position. Every range is read from
+// the contig start of its begin up to the contig start of its end, so the
+// parsers agree on the boundaries without talking to each other.
+uint64_t SAMFile::findContigStart(LineReader& lineReader, uint64_t position) {
+	uint64_t fileSize = lineReader.mapSize();
+	if(position == 0 || position >= fileSize) {
+		return min(position, fileSize);
+	}
+
+	const char* line;
+	int length;
+	const char* fields[SAM_MANDATORY_FIELDS];
+	int lengths[SAM_MANDATORY_FIELDS];
+
+	// skip the rest of the line that contains position - 1
+	lineReader.seek(position - 1);
+	lineReader.nextLine(line, length);
+
+	string contigName;
+	uint64_t lineOffset = lineReader.tell();
+	for(; lineReader.nextLine(line, length); lineOffset = lineReader.tell()) {
+		if (length == 0 || line[0] == '@') {
+			continue;
+		}
 
-    string readName, contigName, cigar, mrnm, seq, qual, optional;
-	int flag, nStart, nMapq, nMpos, nIsize;
-	std::stringstream ssLine(line);
-    ssLine >> readName;
-    ssLine >> flag;
-    ssLine >> contigName;
-    ssLine >> nStart;
-    ssLine >> nMapq;
-    ssLine >> cigar;
-    ssLine >> mrnm;
-    ssLine >> nMpos;
-    ssLine >> nIsize;
-    ssLine >> seq;
-    ssLine >> qual;
-
-    if(contigName.empty() || contigName == "*" ) {
+		int cFields = splitLine(line, length, fields, lengths);
+		if(cFields <= SAM_RNAME || lengths[SAM_RNAME] == 0 || (lengths[SAM_RNAME] == 1 && fields[SAM_RNAME][0] == '*')) {
+			continue;
+		}
+
+		if(contigName.empty()) {
+			contigName.assign(fields[SAM_RNAME], lengths[SAM_RNAME]);
+		} else if(contigName.compare(0, string::npos, fields[SAM_RNAME], lengths[SAM_RNAME]) != 0) {
+			return lineOffset;
+		}
+	}
+
+	return fileSize;
+}
+
+// parse the contigs starting in the byte range from start to end
+void SAMFile::parseRange(uint64_t start, uint64_t end, list<Contig*>& contigs) {
+	LineReader lineReader(_contigFilename);
+	if(!lineReader.openFile()) {
+		return;
+	}
+
+	start = findContigStart(lineReader, start);
+	end = findContigStart(lineReader, end);
+	if(start >= end || !lineReader.seek(start)) {
+		return;
+	}
+
+	SAMContig* pContig = new SAMContig();
+	const char* line;
+	int length;
+
+	while(lineReader.tell() < end && lineReader.nextLine(line, length)) {
+		if (length == 0 || line[0] == '@') {
+			continue;
+		}
+
+		SAMRead* pRead = parseReadLine(line, length, false);
+		if (pRead == NULL) {
+			continue;
+		}
+
+		if(!pContig->getName().empty() && pRead->getContigName() != pContig->getName()) {
+			Contig* pFinished = finishContig(*pContig);
+			if(pFinished != NULL) {
+				contigs.push_back(pFinished);
+			}
+			delete pContig;
+			pContig = new SAMContig();
+		}
+
+		if(pContig->getName().empty()) {
+			pContig->setName(pRead->getContigName());
+		}
+		pContig->addRead(pRead);
+	}
+
+	Contig* pFinished = finishContig(*pContig);
+	if(pFinished != NULL) {
+		contigs.push_back(pFinished);
+	}
+	delete pContig;
+}
+
+void SAMFile::startParsers() {
+	_bStopParsers = false;
+	for(int iThread = 0; iThread < _cParseThreads; iThread++) {
+		SAMParser* pParser = new SAMParser(this);
+		_parsers.push_back(pParser);
+		pParser->start();
+	}
+}
+
+void SAMFile::stopParsers() {
+	if(_parsers.empty()) {
+		return;
+	}
+
+	_mutex.lock();
+	_bStopParsers = true;
+	_rangeTaken.wakeAll();
+	_mutex.unlock();
+
+	vector<SAMParser*>::iterator itParsers;
+	for(itParsers = _parsers.begin(); itParsers != _parsers.end(); itParsers++) {
+		(*itParsers)->wait();
+		delete *itParsers;
+	}
+	_parsers.clear();
+
+	map<int64_t, list<Contig*>*>::iterator itRanges;
+	for(itRanges = _parsedRanges.begin(); itRanges != _parsedRanges.end(); itRanges++) {
+		_parsedContigs.splice(_parsedContigs.end(), *itRanges->second);
+		delete itRanges->second;
+	}
+	_parsedRanges.clear();
+
+	while(!_parsedContigs.empty()) {
+		delete _parsedContigs.front();
+		_parsedContigs.pop_front();
+	}
+}
+
+// the parser threads take turns claiming the next byte range of the file,
+// parse it without holding the lock and hand the contigs over by sequence number
+void SAMFile::runParser() {
+	int maxRangesAhead = SAM_RANGES_AHEAD * _cParseThreads;
+	uint64_t fileSize = _lineReader.mapSize();
+
+	_mutex.lock();
+	while(!_bStopParsers) {
+		if(_bAllRangesClaimed || _nextRangeSequence - _nextTakeSequence >= maxRangesAhead) {
+			_rangeTaken.wait(&_mutex);
+			continue;
+		}
+
+		int64_t sequence = _nextRangeSequence++;
+		list<Contig*>* pContigs = new list<Contig*>();
+		uint64_t start = _nextRangeStart;
+		if(start >= fileSize) {
+			// an empty range marks the end of the file
+			_bAllRangesClaimed = true;
+			_parsedRanges[sequence] = pContigs;
+			_rangeParsed.wakeAll();
+			continue;
+		}
+		_nextRangeStart += SAM_RANGE_SIZE;
+
+		_mutex.unlock();
+		parseRange(start, start + SAM_RANGE_SIZE, *pContigs);
+		_mutex.lock();
+
+		_parsedRanges[sequence] = pContigs;
+		_rangeParsed.wakeAll();
+	}
+	_mutex.unlock();
+}
+
+// hand out the parsed contigs in the order of the file
+Contig* SAMFile::takeParsedContig() {
+	if(_parsers.empty() && !_bParsedEOF) {
+		startParsers();
+	}
+
+	while(_parsedContigs.empty() && !_bParsedEOF) {
+		_mutex.lock();
+		while(_parsedRanges.count(_nextTakeSequence) == 0) {
+			_rangeParsed.wait(&_mutex);
+		}
+
+		list<Contig*>* pContigs = _parsedRanges[_nextTakeSequence];
+		_parsedRanges.erase(_nextTakeSequence);
+		_nextTakeSequence++;
+		_rangeTaken.wakeAll();
+		_bParsedEOF = _bAllRangesClaimed && _parsedRanges.empty() && _nextTakeSequence == _nextRangeSequence;
+		_mutex.unlock();
+
+		_parsedContigs.splice(_parsedContigs.end(), *pContigs);
+		delete pContigs;
+	}
+
+	if(_parsedContigs.empty()) {
+		stopParsers();
+		return NULL;
+	}
+
+	Contig* pContig = _parsedContigs.front();
+	_parsedContigs.pop_front();
+	return pContig;
+}
+
+// return the contig with the given name, using the offset in the contig index
+Contig* SAMFile::getContig(const string& name) {
+    if(_cReads == -1) {
+        collectStatistics();
+    }
+
+    const ContigIndexEntry* pEntry = _contigIndex.findContig(name);
+    if(pEntry == NULL) {
+        Logger::getLogger()->log(QSNP_WARNING, "contig not found in SAM file: " + name);
+        return NULL;
+    }
+
+    if(!_contigIndex.isGrouped()) {
+        stopParsers();
+        _cParseThreads = 0;
+        return readContigBlocks(name);
+    }
+
+    if(!openFile() || !_lineReader.seek(pEntry->offset)) {
+        Logger::getLogger()->log(QSNP_ERROR, "could not seek to contig: " + name);
         return NULL;
     }
 
-    string group;
-    while(ssLine >> optional) {
-        if(optional.substr(0,3).compare("RG:") == 0) {
-            size_t valueStart = optional.find(":", 4);
-            group = optional.substr(valueStart + 1);
+    delete _pRead;
+    _pRead = NULL;
+
+    // after a seek the file is read serially
+    stopParsers();
+    _cParseThreads = 0;
+
+    // a contig of only low mapping quality reads gives the next contig
+    Contig* pContig = readContig();
+    if(pContig != NULL && pContig->getName() != name) {
+        delete pContig;
+        return NULL;
+    }
+
+    return pContig;
+}
+
+// in an unsorted file the reads of a contig are in several blocks, the
+// contig index has an entry for each of them
+Contig* SAMFile::readContigBlocks(const string& name) {
+    if(!openFile()) {
+        return NULL;
+    }
+
+    SAMContig contig;
+    const char* line;
+    int length;
+
+    const vector<ContigIndexEntry>& entries = _contigIndex.getContigs();
+    vector<ContigIndexEntry>::const_iterator itEntries;
+    for(itEntries = entries.begin(); itEntries != entries.end(); itEntries++) {
+        if(itEntries->name != name) {
+            continue;
+        }
+
+        if(!_lineReader.seek(itEntries->offset)) {
+            Logger::getLogger()->log(QSNP_ERROR, "could not seek to contig: " + name);
+            return NULL;
+        }
+
+        uint64_t end = itEntries->offset + itEntries->size;
+        while(_lineReader.tell() < end && _lineReader.nextLine(line, length)) {
+            if (length == 0 || line[0] == '@') {
+                continue;
+            }
+
+            SAMRead* pRead = parseReadLine(line, length, false);
+            if(pRead == NULL) {
+                continue;
+            }
+            if(pRead->getContigName() != name) {
+                delete pRead;
+                continue;
+            }
+
+            if(contig.getName().empty()) {
+                contig.setName(name);
+            }
+            contig.addRead(pRead);
+        }
+    }
+
+    return finishContig(contig);
+}
+
+// read the whole input once and store the accepted alignment lines per contig,
+// in memory up to the memory budget and in spill files next to the output
+bool SAMFile::groupLines() {
+    Configuration* pConfig = Configuration::getConfig();
+    uint64_t memoryBudget = static_cast<uint64_t>(max(pConfig->getInt("groupingMemory"), 1)) << 20;
+    string spillPrefix = pConfig->getString("outputDirectory") + "/"
+        + (_bStdin ? string("stdin") : _contigFilename.substr(_contigFilename.find_last_of("/\\") + 1));
+
+    _pGrouper = new ContigGrouper(spillPrefix, memoryBudget);
+
+    const char* line;
+    int length;
+    const char* fields[SAM_MANDATORY_FIELDS];
+    int lengths[SAM_MANDATORY_FIELDS];
+
+    while(_lineReader.nextLine(line, length)) {
+        if (length == 0 || line[0] == '@') {
+            continue;
+        }
+
+        int cFields = splitLine(line, length, fields, lengths, SAM_CIGAR);
+        if(cFields <= SAM_RNAME || lengths[SAM_RNAME] == 0 || (lengths[SAM_RNAME] == 1 && fields[SAM_RNAME][0] == '*')) {
+            continue;
         }
+
+        // filtered reads are not stored
+        int nFlag, nMapq;
+        if(cFields == SAM_CIGAR && parseInt(fields[SAM_FLAG], lengths[SAM_FLAG], nFlag)
+                && parseInt(fields[SAM_MAPQ], lengths[SAM_MAPQ], nMapq) && !acceptRead(nFlag, nMapq)) {
+            continue;
+        }
+
+        if(!_pGrouper->addLine(fields[SAM_RNAME], lengths[SAM_RNAME], line, length)) {
+            return false;
+        }
+    }
+
+    if(_pGrouper->getSpillCount() > 0) {
+        stringstream ssSpills;
+        ssSpills << "grouped the reads by contig using " << _pGrouper->getSpillCount() << " spill files";
+        Logger::getLogger()->log(QSNP_INFO, ssSpills.str());
+    }
+
+    return true;
+}
+
+// the next contig of the grouped input, contigs without accepted reads are skipped
+Contig* SAMFile::readGroupedContig() {
+    if(_pGrouper == NULL && !groupLines()) {
+        return NULL;
     }
 
-	SAMRead* pRead = new SAMRead(readName);
-    pRead->setGroup(group);
-    pRead->setContigName(contigName);
+    string contigName;
+    string lines;
+    while(_pGrouper->nextGroup(contigName, lines)) {
+        SAMContig contig;
+        const char* line = lines.data();
+        const char* end = line + lines.size();
+
+        while(line < end) {
+            const char* lineEnd = static_cast<const char*>(memchr(line, '\n', end - line));
+            if(lineEnd == NULL) {
+                lineEnd = end;
+            }
 
-    if(bCollectStatics) {
-        return pRead;
+            SAMRead* pRead = parseReadLine(line, lineEnd - line, false);
+            if (pRead != NULL) {
+                if(_bStdin) {
+                    _cReads = max(_cReads, 0) + 1;
+                }
+                if(contig.getName().empty()) {
+                    contig.setName(pRead->getContigName());
+                }
+                contig.addRead(pRead);
+            }
+            line = lineEnd + 1;
+        }
+
+        Contig* pContig = finishContig(contig);
+        if(pContig != NULL) {
+            return pContig;
+        }
     }
 
-    Logger::getLogger()->log(QSNP_DEBUG, "parseReadLine for read: " + readName + " (" + contigName + ")");
+    return NULL;
+}
 
-    pRead->setSequence(seq);
+// split the first cMaxFields fields of a line on tabs, without copying them
+// returns the number of fields found
+int SAMFile::splitLine(const char* line, int length, const char** fields, int* lengths, int cMaxFields) {
+	const char* p = line;
+	const char* end = line + length;
+	int cFields = 0;
+
+	while(cFields < cMaxFields && p <= end) {
+		const char* tab = static_cast<const char*>(memchr(p, '\t', end - p));
+		if(tab == NULL) {
+			tab = end;
+		}
+		fields[cFields] = p;
+		lengths[cFields] = tab - p;
+		cFields++;
+		p = tab + 1;
+	}
+
+	return cFields;
+}
+
+// return the value of the RG tag from the optional fields, if present
+string SAMFile::findReadGroup(const char* optional, const char* end) {
+	const char* p = optional;
+	while(p + 5 <= end) {
+		const char* tab = static_cast<const char*>(memchr(p, '\t', end - p));
+		if(tab == NULL) {
+			tab = end;
+		}
+		if(p[0] == 'R' && p[1] == 'G' && p[2] == ':') {
+			// skip the type, RG:Z:value
+			const char* value = static_cast<const char*>(memchr(p + 3, ':', tab - p - 3));
+			if(value != NULL) {
+				return string(value + 1, tab - value - 1);
+			}
+		}
+		p = tab + 1;
+	}
+
+	return string();
+}
+
+// the read filters of the configuration: all include flags set, none of the
+// exclude flags set and a high enough mapping quality
+bool SAMFile::acceptRead(int flag, int mapQuality) {
+	return (flag & _includeFlags) == _includeFlags && (flag & _excludeFlags) == 0 && mapQuality >= _minimalMappingQuality;
+}
+
+SAMRead* SAMFile::parseReadLine(const char* line, int length, bool bCollectStatics) {
+//SPWG_7257172	35	Contig_23	1	60	19S80M	=	3	120	CATTTATCGCCTCAGAGTTCATGGCTATGAAACCAAAACAGAGAGTGTAGAAGATGAAAGCATGAGATGATGATATTTGAATTTGCTGCTTCATATTGT	GHIIGIIIIDIIIIIIGIIIGIIIIIIIIHIIIIIIIIIFIIIHIDGFIGFBIGHIDIIIIHIIBIFHHHGIHGHGIHBHFIHHGHEGDBEEGE>EC>C	NH:i:1
+
+	const char* fields[SAM_MANDATORY_FIELDS];
+	int lengths[SAM_MANDATORY_FIELDS];
+	const char* end = line + length;
+
+	// the filters only need the first five fields, the rest is split for accepted reads
+	int cFields = splitLine(line, length, fields, lengths, SAM_CIGAR);
+
+	if(cFields <= SAM_RNAME || lengths[SAM_RNAME] == 0 || (lengths[SAM_RNAME] == 1 && fields[SAM_RNAME][0] == '*')) {
+		return NULL;
+	}
+
+	int nFlag = 0, nMapq = 0;
+	if(!bCollectStatics && cFields == SAM_CIGAR) {
+		if(!parseInt(fields[SAM_FLAG], lengths[SAM_FLAG], nFlag) || !parseInt(fields[SAM_MAPQ], lengths[SAM_MAPQ], nMapq)) {
+			Logger::getLogger()->log(QSNP_ERROR, "Invalid flag or mapping quality in SAM line: " + string(line, length));
+			return NULL;
+		}
+		if(!acceptRead(nFlag, nMapq)) {
+			Logger::getLogger()->log(QSNP_DEBUG, "Skipping read (" + string(fields[SAM_QNAME], lengths[SAM_QNAME]) + ") by flag or mapping quality");
+			return NULL;
+		}
+	}
+
+	const char* rest = fields[SAM_MAPQ] + lengths[SAM_MAPQ] + 1;
+	if(cFields == SAM_CIGAR && rest <= end) {
+		cFields += splitLine(rest, end - rest, fields + SAM_CIGAR, lengths + SAM_CIGAR, SAM_MANDATORY_FIELDS - SAM_CIGAR);
+	}
+
+	if(cFields < SAM_MANDATORY_FIELDS) {
+		Logger::getLogger()->log(QSNP_ERROR, "Too few fields in SAM line: " + string(line, length));
+		return NULL;
+	}
+
+	// reads outside the target regions are skipped before anything is allocated
+	if(_pRegions != NULL && !bCollectStatics) {
+		int nRegionStart;
+		if(!parseInt(fields[SAM_POS], lengths[SAM_POS], nRegionStart)) {
+			return NULL;
+		}
+		int nRegionEnd = nRegionStart + max(referenceLength(fields[SAM_CIGAR], lengths[SAM_CIGAR]) - 1, 0);
+		if(!_pRegions->overlaps(fields[SAM_RNAME], lengths[SAM_RNAME], nRegionStart, nRegionEnd)) {
+			return NULL;
+		}
+	}
+
+	const char* optional = fields[SAM_QUAL] + lengths[SAM_QUAL] + 1;
+
+	SAMRead* pRead = new SAMRead(string(fields[SAM_QNAME], lengths[SAM_QNAME]));
+	pRead->setGroup(optional < end ? findReadGroup(optional, end) : string());
+	pRead->setContigName(string(fields[SAM_RNAME], lengths[SAM_RNAME]));
+
+	if(bCollectStatics) {
+		return pRead;
+	}
+
+	Logger::getLogger()->log(QSNP_DEBUG, "parseReadLine for read: " + pRead->getName() + " (" + pRead->getContigName() + ")");
+
+	int nStart;
+	if(!parseInt(fields[SAM_POS], lengths[SAM_POS], nStart)) {
+		Logger::getLogger()->log(QSNP_ERROR, "Invalid position for read: " + pRead->getName());
+		delete pRead;
+		return NULL;
+	}
+
+    pRead->setSequence(string(fields[SAM_SEQ], lengths[SAM_SEQ]));
     pRead->setStartPosition(nStart);
-    pRead->setQuality(qual);
+    pRead->setQuality(string(fields[SAM_QUAL], lengths[SAM_QUAL]));
     pRead->setMapQuality(nMapq);
 
-	list<operation>& ops = pRead->getOperations();
-	if(parseCigar(cigar, ops) && pRead->processOperations()) {
+	vector<uint32_t>& packedCigar = pRead->getCigar();
+	if(parseCigar(fields[SAM_CIGAR], lengths[SAM_CIGAR], packedCigar) && pRead->processOperations()) {
 		return pRead;
 	}
 
@@ -187,82 +706,188 @@ SAMRead* SAMFile::parseReadLine(const string& line, bool bCollectStatics) {
     return NULL;
 }
 
+// statistics come from the contig index if there is a valid one, otherwise
+// the file is scanned once and the index is written for the next run
 bool SAMFile::collectStatistics()
 {
-    if(!openFile()) {
+    _cReads = 0;
+    _cContigs = 0;
+    _readGroups.clear();
+
+    if(_contigFilename == STDIN_FILENAME) {
+        return collectHeaderStatistics();
+    }
+
+    if(!_contigIndex.load() && !buildIndex()) {
         return false;
     }
 
-    _ifSAMFile.seekg (0, ios::beg);
+    _cReads = _contigIndex.getReadCount();
+    _cContigs = _contigIndex.getContigNameCount();
+    _readGroups = _contigIndex.getReadGroups();
+    sort(_readGroups.begin(), _readGroups.end());
 
-    _cReads = 0;
-    _cContigs = 0;
-    _readGroups.clear();
+    if(!_contigIndex.isGrouped() && !_bGroupContigs) {
+        Logger::getLogger()->log(QSNP_INFO, "the SAM file is not sorted by reference, grouping the reads by contig: " + _contigFilename);
+        _bGroupContigs = true;
+    }
 
-    string line;
-    string contigName;
-    map<string,int> groupMap;
+    return true;
+}
 
-    while(getline(_ifSAMFile,line)) {
-        if (!emptyLine(line) && line[0] != '@') {
-            SAMRead* pRead = parseReadLine(line, true);
-            if (pRead != NULL) {
-                _cReads++;
-                if(!pRead->getGroup().empty()) {
-                    groupMap[pRead->getGroup()]++;
+// standard input can only be read once, so the statistics come from the
+// header: the @SQ lines give the contigs and the @RG lines the read groups.
+// The read count grows while the reads are read.
+bool SAMFile::collectHeaderStatistics()
+{
+    if(!openFile()) {
+        return false;
+    }
+
+    const char* line;
+    int length;
+    uint64_t lineOffset = _lineReader.tell();
+    for(; _lineReader.nextLine(line, length); lineOffset = _lineReader.tell()) {
+        if(length == 0) {
+            continue;
+        }
+        if(line[0] != '@') {
+            break;
+        }
+
+        if(length > 3 && line[1] == 'S' && line[2] == 'Q' && line[3] == '\t') {
+            _cContigs++;
+        } else if(length > 3 && line[1] == 'R' && line[2] == 'G' && line[3] == '\t') {
+            const char* lineEnd = line + length;
+            const char* p = line + 4;
+            while(p < lineEnd) {
+                const char* tab = static_cast<const char*>(memchr(p, '\t', lineEnd - p));
+                if(tab == NULL) {
+                    tab = lineEnd;
                 }
-                if(contigName != pRead->getContigName()) {
-                    contigName = pRead->getContigName();
-                    _cContigs++;
+                if(tab - p > 3 && p[0] == 'I' && p[1] == 'D' && p[2] == ':') {
+                    _readGroups.push_back(string(p + 3, tab - p - 3));
                 }
-                delete pRead;
+                p = tab + 1;
             }
         }
     }
 
+    // the first alignment line is still in the buffer of the reader
+    _lineReader.seek(lineOffset);
+
+    sort(_readGroups.begin(), _readGroups.end());
+    _readGroups.erase(unique(_readGroups.begin(), _readGroups.end()), _readGroups.end());
+    return true;
+}
+
+bool SAMFile::buildIndex()
+{
+    _contigIndex.clear();
+
+    // use a reader of its own, so the position of the contig reader is kept
+    LineReader lineReader(_contigFilename);
+    if(!lineReader.openFile()) {
+        return false;
+    }
+
+    const char* line;
+    int length;
+    const char* fields[SAM_MANDATORY_FIELDS];
+    int lengths[SAM_MANDATORY_FIELDS];
+    string contigName;
+    ContigIndexEntry* pEntry = NULL;
+    uint64_t lineOffset = lineReader.tell();
+
+    for(; lineReader.nextLine(line, length); lineOffset = lineReader.tell()) {
+        if (length == 0 || line[0] == '@') {
+            continue;
+        }
 
-    map<string,int>::iterator itGroupMap;
-    for(itGroupMap = groupMap.begin(); itGroupMap != groupMap.end(); itGroupMap++) {
-        _readGroups.push_back((*itGroupMap).first);
+        int cFields = splitLine(line, length, fields, lengths);
+        if(cFields <= SAM_RNAME || lengths[SAM_RNAME] == 0 || (lengths[SAM_RNAME] == 1 && fields[SAM_RNAME][0] == '*')) {
+            continue;
+        }
+
+        if(pEntry == NULL || contigName.compare(0, string::npos, fields[SAM_RNAME], lengths[SAM_RNAME]) != 0) {
+            if(pEntry != NULL) {
+                pEntry->size = lineOffset - pEntry->offset;
+            }
+            contigName.assign(fields[SAM_RNAME], lengths[SAM_RNAME]);
+            pEntry = &_contigIndex.addContig(contigName, lineOffset);
+        }
+
+        string group;
+        if(cFields == SAM_MANDATORY_FIELDS) {
+            const char* optional = fields[SAM_QUAL] + lengths[SAM_QUAL] + 1;
+            if(optional < line + length) {
+                group = findReadGroup(optional, line + length);
+            }
+        }
+        _contigIndex.addRead(*pEntry, group);
+
+        int nStart;
+        if(cFields > SAM_CIGAR && parseInt(fields[SAM_POS], lengths[SAM_POS], nStart)) {
+            int readEnd = nStart - 1 + referenceLength(fields[SAM_CIGAR], lengths[SAM_CIGAR]);
+            if(readEnd > pEntry->length) {
+                pEntry->length = readEnd;
+            }
+        }
+    }
+
+    if(pEntry != NULL) {
+        pEntry->size = lineOffset - pEntry->offset;
     }
 
-    _ifSAMFile.clear();
-    _ifSAMFile.seekg (0, ios::beg);
+    _contigIndex.save();
     return true;
 }
 
-bool SAMFile::parseCigar(const string& cigar, list<operation>& ops) {
-    if(cigar == "*") {
+// the number of reference positions covered by a cigar string
+int SAMFile::referenceLength(const char* cigar, int length) {
+	int cPositions = 0;
+	int iSize = 0;
+	for(int i = 0; i < length; i++) {
+		char c = cigar[i];
+		if(c >= '0' && c <= '9') {
+			iSize = iSize * 10 + (c - '0');
+		} else {
+			if(c == 'M' || c == 'D' || c == 'N' || c == '=' || c == 'X') {
+				cPositions += iSize;
+			}
+			iSize = 0;
+		}
+	}
+
+	return cPositions;
+}
+
+bool SAMFile::parseCigar(const char* cigar, int length, vector<uint32_t>& packedCigar) {
+    if(length == 1 && cigar[0] == '*') {
 		Logger::getLogger()->log(QSNP_DEBUG, "skipping read with cigar *");
 		return false;
     }
 
-	size_t prevFound = 0;
-	size_t found = cigar.find_first_of ("MIDNSHP", prevFound);
-
-	while(found != string::npos) {
-		char cOperation = cigar[found];
-		int iSize;
-
-		if(from_string<int>(iSize, cigar.substr(prevFound, found - prevFound), std::dec)) {
-			operation op = {cOperation, iSize};
-			ops.push_back(op);
+	int iSize = 0;
+	bool bDigits = false;
+	for(int i = 0; i < length; i++) {
+		char c = cigar[i];
+		if(c >= '0' && c <= '9') {
+			iSize = iSize * 10 + (c - '0');
+			bDigits = true;
+		} else if(bDigits && c != '\0' && strchr(CIGAR_OPERATIONS, c) != NULL) {
+			packedCigar.push_back(packCigar(strchr(CIGAR_OPERATIONS, c) - CIGAR_OPERATIONS, iSize));
+			iSize = 0;
+			bDigits = false;
 		} else {
-			Logger::getLogger()->log(QSNP_ERROR, "Parsing of cigar line failed: " + cigar);
+			Logger::getLogger()->log(QSNP_ERROR, "Parsing of cigar line failed: " + string(cigar, length));
 			return false;
 		}
-		prevFound = found + 1;
-		found = cigar.find_first_of ("MIDNSHP", prevFound);
-	} 
+	}
 
 	return true;
 }
 
-
-bool SAMFile::emptyLine(const string& line) {
-	return line.empty() || (line.size() == 1 && line[0] == '\r');
-}
-
 int SAMFile::readCount()
 {
     if(_cReads == -1) {
@@ -25,8 +25,35 @@
 #include <fstream>
 #include <vector>
 #include <list>
+#include <map>
+#include <set>
+#include <stdint.h>
+#include <QMutex>
+#include <QWaitCondition>
 #include "SAMRead.h"
+#include "LineReader.h"
+#include "ContigIndex.h"
 #include "ContigFile.h"
+#include "ContigGrouper.h"
+
+class SAMParser;
+class SAMContig;
+
+// the mandatory fields of a SAM alignment line
+enum SAMField {
+	SAM_QNAME,
+	SAM_FLAG,
+	SAM_RNAME,
+	SAM_POS,
+	SAM_MAPQ,
+	SAM_CIGAR,
+	SAM_RNEXT,
+	SAM_PNEXT,
+	SAM_TLEN,
+	SAM_SEQ,
+	SAM_QUAL,
+	SAM_MANDATORY_FIELDS
+};
 
 class SAMFile : public ContigFile
 {
@@ -35,6 +62,9 @@ public:
 	~SAMFile(void);
 
 	Contig* nextContig();
+	Contig* getContig(const string& name);
+	void setRegions(RegionList* pRegions) { _pRegions = pRegions; }
+	void setReference(ReferenceFile* pReference) { _pReference = pReference; }
 	bool openFile();
 	bool isValid();
     int  readCount();
@@ -42,18 +72,64 @@ public:
     vector<string>& readGroups();
 
 private:
-	bool parseCigar(const string&, list<operation>&);
-	bool emptyLine(const string&);
-    SAMRead* parseReadLine(const string&, bool bCollectStatics);
+	friend class SAMParser;
+
+	Contig* readContig();
+	Contig* readContigBlocks(const string& name);
+	bool groupLines();
+	Contig* readGroupedContig();
+	Contig* finishContig(SAMContig& contig);
+	uint64_t findContigStart(LineReader& lineReader, uint64_t position);
+	void parseRange(uint64_t start, uint64_t end, list<Contig*>& contigs);
+	Contig* takeParsedContig();
+	void startParsers();
+	void stopParsers();
+	void runParser();
+	bool parseCigar(const char* cigar, int length, vector<uint32_t>& packedCigar);
+	int splitLine(const char* line, int length, const char** fields, int* lengths, int cMaxFields = SAM_MANDATORY_FIELDS);
+	string findReadGroup(const char* optional, const char* end);
+    bool acceptRead(int flag, int mapQuality);
+    SAMRead* parseReadLine(const char* line, int length, bool bCollectStatics);
     bool collectStatistics();
+    bool buildIndex();
+    bool collectHeaderStatistics();
+    int referenceLength(const char* cigar, int length);
 
 private:
     string          _contigFilename;
-    ifstream        _ifSAMFile;
+    LineReader      _lineReader;
+    ContigIndex     _contigIndex;
+    RegionList*     _pRegions;
+    ReferenceFile*  _pReference;
     SAMRead*        _pRead;
     int             _cReads;
     int             _cContigs;
     vector<string>  _readGroups;
+    int             _includeFlags;
+    int             _excludeFlags;
+    int             _minimalMappingQuality;
+    bool            _bStdin;
+
+    // unsorted input is grouped by contig before it is parsed
+    bool            _bGroupContigs;
+    ContigGrouper*  _pGrouper;
+    set<string>     _finishedContigs;
+    bool            _bWarnedUnsorted;
+
+    // parser pool, reading byte ranges that start at a contig change
+    int                         _cParseThreads;
+    vector<SAMParser*>          _parsers;
+    QMutex                      _mutex;
+    QWaitCondition              _rangeParsed;
+    QWaitCondition              _rangeTaken;
+    map<int64_t, list<Contig*>*> _parsedRanges;
+    list<Contig*>               _parsedContigs;
+    int64_t                     _nextRangeSequence;
+    int64_t                     _nextTakeSequence;
+    uint64_t                    _nextRangeStart;
+    bool                        _bAllRangesClaimed;
+    bool                        _bParsedEOF;
+    bool                        _bStopParsers;
 };
 
 #endif
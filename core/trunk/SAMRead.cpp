@@ -18,8 +18,7 @@
 *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include <list>
-#include <sstream>
+#include <algorithm>
 #include <cstdlib>
 #include "Logger.h"
 #include "SAMRead.h"
@@ -44,72 +43,109 @@ void SAMRead::setQuality(const string& quality) {
 	}
 }
 
+// expand the read to the reference: the clipped ends are removed and the
+// deletions, skips and paddings are filled with gaps. The gapped sequence,
+// operations and qualities are written in one pass into buffers of the final size.
 bool SAMRead::processOperations() {
-	list<operation>::iterator itOps;
+	_bHasInsertions = false;
 
-    _bHasInsertions = false;
-	_opsequence.assign(_sequence.size(),' ');
-
-	//remove hard clip operations from front and back
-	if (_ops.front().op == 'H') {
-		_ops.pop_front();
+	//skip hard clip operations at front and back
+	size_t iFirst = 0;
+	size_t iLast = _cigar.size();
+	if (iFirst < iLast && cigarOperation(_cigar[iFirst]) == CIGAR_HARD_CLIP) {
+		iFirst++;
 	}
-	if(_ops.back().op == 'H') {
-		_ops.pop_back();
+	if (iFirst < iLast && cigarOperation(_cigar[iLast - 1]) == CIGAR_HARD_CLIP) {
+		iLast--;
 	}
 
 	//trim soft clipped ends
-	if (_ops.front().op == 'S') {
-		if (_sequence.size() < _ops.front().size) {
+	size_t clipStart = 0;
+	size_t readLength = _sequence.size();
+	if (iFirst < iLast && cigarOperation(_cigar[iFirst]) == CIGAR_SOFT_CLIP) {
+		clipStart = cigarLength(_cigar[iFirst]);
+		if (readLength < clipStart) {
 			Logger::getLogger()->log(QSNP_ERROR, "Sequence shorter than expected from cigar operations for read:  " + _name);
 			return false;
 		}
-		_sequence = _sequence.substr(_ops.front().size);
-		_ops.pop_front();
+		readLength -= clipStart;
+		iFirst++;
 	}
-	if(_ops.back().op == 'S') {
-		int newSize = _sequence.size() - _ops.back().size;
-		if (newSize < 0) {
+	if (iFirst < iLast && cigarOperation(_cigar[iLast - 1]) == CIGAR_SOFT_CLIP) {
+		size_t clipEnd = cigarLength(_cigar[iLast - 1]);
+		if (readLength < clipEnd) {
 			Logger::getLogger()->log(QSNP_ERROR, "Sequence shorter than expected from cigar operations for read:  " + _name);
 			return false;
 		}
-
-		_sequence.resize(newSize);
-		_ops.pop_back();
+		readLength -= clipEnd;
+		iLast--;
 	}
 
-	int nPosition = 0;
-	for ( itOps=_ops.begin() ; itOps != _ops.end(); itOps++ ) {
-		switch ((*itOps).op) {
-			case 'S':
+	size_t cGaps = 0;
+	for (size_t iOp = iFirst; iOp < iLast; iOp++) {
+		switch (cigarOperation(_cigar[iOp])) {
+			case CIGAR_SOFT_CLIP:
 				Logger::getLogger()->log(QSNP_ERROR, "Internal S in SAM cigar line for read: " + _name);
 				return false;
+			case CIGAR_PADDING:
+			case CIGAR_DELETION:
+			case CIGAR_SKIP:
+				cGaps += cigarLength(_cigar[iOp]);
 				break;
-			case 'M':
-			case 'I':
-				for(int i = nPosition; i < nPosition + (*itOps).size; i++) {
-					_opsequence[i] = (*itOps).op;
-				}
-                _bHasInsertions = true;
-				break;
-			case 'P':
-			case 'D':
-			case 'N':
-				_sequence.insert(nPosition, (*itOps).size,'*');
-				_opsequence.insert(nPosition, (*itOps).size,(*itOps).op);
-				_quality.insert(nPosition, (*itOps).size,'~'); //~ is the highest quality score
+			case CIGAR_INSERTION:
+				_bHasInsertions = true;
 				break;
-			case '=':
-			case 'X':
-				for(int i = nPosition; i < nPosition + (*itOps).size; i++) {
-					_opsequence[i] = (*itOps).op;
-				}
 			default:
 				break;
-		} 
-		nPosition += (*itOps).size;
+		}
+	}
+
+	// the qualities keep the soft clipped ends, gaps are inserted at the same
+	// positions as in the sequence
+	const char* sequence = _sequence.data() + clipStart;
+	const char* quality = _quality.data();
+	size_t qualityLength = _quality.size();
+
+	string gappedSequence(readLength + cGaps, ' ');
+	string gappedOperations(readLength + cGaps, ' ');
+	string gappedQuality(qualityLength + cGaps, '~'); //~ is the highest quality score
+
+	size_t nPosition = 0;	// in the gapped read
+	size_t nRead = 0;		// in the clipped sequence
+	size_t nQuality = 0;
+	for (size_t iOp = iFirst; iOp < iLast; iOp++) {
+		int op = cigarOperation(_cigar[iOp]);
+		size_t size = cigarLength(_cigar[iOp]);
+
+		if (op == CIGAR_PADDING || op == CIGAR_DELETION || op == CIGAR_SKIP) {
+			gappedSequence.replace(nPosition, size, size, '*');
+			gappedOperations.replace(nPosition, size, size, CIGAR_OPERATIONS[op]);
+			nPosition += size;
+			continue;
+		}
+
+		size_t cBases = min(size, readLength - nRead);
+		gappedSequence.replace(nPosition, cBases, sequence + nRead, cBases);
+		if (op == CIGAR_MATCH || op == CIGAR_INSERTION || op == CIGAR_EQUAL || op == CIGAR_DIFF) {
+			gappedOperations.replace(nPosition, cBases, cBases, CIGAR_OPERATIONS[op]);
+		}
+
+		size_t cQualities = min(size, qualityLength - nQuality);
+		gappedQuality.replace(nPosition + nQuality - nRead, cQualities, quality + nQuality, cQualities);
+
+		nPosition += cBases;
+		nRead += cBases;
+		nQuality += cQualities;
 	}
 
+	// bases and qualities not covered by the cigar operations
+	gappedSequence.replace(nPosition, readLength - nRead, sequence + nRead, readLength - nRead);
+	gappedQuality.replace(nPosition + nQuality - nRead, qualityLength - nQuality, quality + nQuality, qualityLength - nQuality);
+
+	_sequence.swap(gappedSequence);
+	_opsequence.swap(gappedOperations);
+	_quality.swap(gappedQuality);
+
 	return true;
 }
 
@@ -133,27 +169,104 @@ char SAMRead::getOperationAt(unsigned int pos) {
 	return (pos > _opsequence.size() - 1) ? '>' : _opsequence[pos];
 }
 
-bool SAMRead::insertGapAt(unsigned int pos) {
-	pos--;
-	if(_startPosition >= 0 && pos < static_cast<unsigned int>(_startPosition)) {
-		_startPosition++;
-        return true;
+// add the insertions of this read, with the reference position they are in front of
+void SAMRead::collectInsertions(vector<InsertionColumns>& insertions) {
+	int position = _startPosition;
+	size_t length = _opsequence.size();
+	for(size_t i = 0; i < length;) {
+		if(_opsequence[i] != 'I') {
+			position++;
+			i++;
+			continue;
+		}
+
+		size_t start = i;
+		while(i < length && _opsequence[i] == 'I') {
+			i++;
+		}
+
+		InsertionColumns insertion;
+		insertion.position = position;
+		insertion.length = i - start;
+		insertion.cBefore = 0;
+		insertions.push_back(insertion);
 	}
+}
 
-	char chGap = '*';
+// stretch the read to the insertion columns of the contig in one pass. The
+// read is moved right by the insertion columns in front of it and gets gaps
+// where other reads have longer insertions. Its own insertions come first in
+// the insertion columns, a read does not get gaps after its last base.
+void SAMRead::padInsertions(const vector<InsertionColumns>& insertions, int cInsertionColumns) {
+	vector<InsertionColumns>::const_iterator itInsertions = lower_bound(insertions.begin(), insertions.end(), _startPosition);
+	int startPosition = _startPosition + ((itInsertions == insertions.end()) ? cInsertionColumns : itInsertions->cBefore);
 
-	pos -= _startPosition;
-	if (pos < _sequence.size() && _opsequence[pos] != 'I') {
-		_sequence.insert(pos, 1, chGap);
-		_opsequence.insert(pos, 1, 'I');
-		_quality.insert(pos, 1, '~'); // ~ is the highest quality score
-        return true;
-    }
-
-    // position is after the end;
-    return false;
+	size_t length = _sequence.size();
+	int lastPosition = _startPosition + length;
+	if(!_bHasInsertions && (itInsertions == insertions.end() || itInsertions->position >= lastPosition)) {
+		// no insertion columns inside the read
+		_startPosition = startPosition;
+		return;
+	}
+
+	if(_quality.size() < length) {
+		_quality.resize(length, '~');
+	}
+
+	string sequence;
+	string operations;
+	string quality;
+	sequence.reserve(length + cInsertionColumns);
+	operations.reserve(length + cInsertionColumns);
+	quality.reserve(_quality.size() + cInsertionColumns);
+
+	int position = _startPosition;
+	size_t i = 0;
+	while(i < length) {
+		size_t start = i;
+		while(i < length && _opsequence[i] == 'I') {
+			i++;
+		}
+		size_t cOwnColumns = i - start;
+		sequence.append(_sequence, start, cOwnColumns);
+		operations.append(_opsequence, start, cOwnColumns);
+		quality.append(_quality, start, cOwnColumns);
+		if(i == length) {
+			break;
+		}
+
+		while(itInsertions != insertions.end() && itInsertions->position < position) {
+			itInsertions++;
+		}
+		if(itInsertions != insertions.end() && itInsertions->position == position && static_cast<size_t>(itInsertions->length) > cOwnColumns) {
+			size_t cGaps = itInsertions->length - cOwnColumns;
+			sequence.append(cGaps, '*');
+			operations.append(cGaps, 'I');
+			quality.append(cGaps, '~'); // ~ is the highest quality score
+		}
+
+		sequence.push_back(_sequence[i]);
+		operations.push_back(_opsequence[i]);
+		quality.push_back(_quality[i]);
+		position++;
+		i++;
+	}
+
+	// the qualities of a soft clipped end are kept after the read
+	if(_quality.size() > length) {
+		quality.append(_quality, length, string::npos);
+	}
+
+	_startPosition = startPosition;
+	_sequence.swap(sequence);
+	_opsequence.swap(operations);
+	_quality.swap(quality);
 }
 
+// merge the mate of a read pair into this read. Where the mates overlap the
+// bases with the higher quality are kept, between them the merged read gets
+// blanks. The merged sequence and qualities are written into buffers of the
+// final size.
 void SAMRead::merge(SAMRead* pRead) {
 	SAMRead* pRead1;
 	SAMRead* pRead2;
@@ -166,41 +279,48 @@ void SAMRead::merge(SAMRead* pRead) {
 		pRead2 = this;
 	}
 
-	stringstream ss;
-	stringstream qual;
-
-	int spacing = pRead2->getStartPosition() - pRead1->getStartPosition() - pRead1->getSequence().size();
+	size_t cSequence1 = pRead1->_sequence.size();
+	size_t cQuality1 = pRead1->_quality.size();
+	int spacing = pRead2->getStartPosition() - pRead1->getStartPosition() - cSequence1;
 	if(spacing < 0) {
 		// overlapping sequences
-		int limit = (abs(spacing) > pRead2->getQuality().size() ) ? pRead2->getQuality().size() + spacing : 0;
+		int limit = (abs(spacing) > pRead2->_quality.size() ) ? pRead2->_quality.size() + spacing : 0;
 
 		for(int i = spacing; i < limit; i++) {
-			if(pRead2->getQuality()[i - spacing] < pRead1->getQuality()[pRead1->getQuality().size() + i]) {
-				pRead2->_sequence[i - spacing] = pRead1->getSequence()[pRead1->getSequence().size() + i];
-				pRead2->_quality[i - spacing] = pRead1->getQuality()[pRead1->getQuality().size() + i];
+			if(pRead2->_quality[i - spacing] < pRead1->_quality[cQuality1 + i]) {
+				pRead2->_sequence[i - spacing] = pRead1->_sequence[cSequence1 + i];
+				pRead2->_quality[i - spacing] = pRead1->_quality[cQuality1 + i];
 			}
 		}
-		pRead1->setSequence(pRead1->getSequence().substr(0,pRead1->getSequence().size() + spacing));
-		pRead1->setQuality(pRead1->getQuality().substr(0,pRead1->getQuality().size() + spacing));
-
-		ss << pRead1->getSequence() << pRead2->getSequence();
-		qual << pRead1->getQuality() << pRead2->getQuality();
-	} else {
-		ss << pRead1->getSequence() << string(spacing, ' ') << pRead2->getSequence();
-		qual << pRead1->getQuality() << string(spacing, '~') << pRead2->getQuality();
+		cSequence1 += spacing;
+		cQuality1 += spacing;
+		spacing = 0;
 	}
 
+	string sequence;
+	sequence.reserve(cSequence1 + spacing + pRead2->_sequence.size());
+	sequence.append(pRead1->_sequence, 0, cSequence1);
+	sequence.append(spacing, ' ');
+	sequence.append(pRead2->_sequence);
+
+	string quality;
+	quality.reserve(cQuality1 + spacing + pRead2->_quality.size());
+	quality.append(pRead1->_quality, 0, cQuality1);
+	quality.append(spacing, '~'); // ~ is the highest quality score
+	quality.append(pRead2->_quality);
+
 	_startPosition = pRead1->getStartPosition();
-	_sequence = ss.str();
-	_quality= qual.str();
+	_sequence.swap(sequence);
+	_quality.swap(quality);
 }
 
-SeqRead* SAMRead::toSeqRead() {
-	SeqRead* pRead = new SeqRead(_name);
-	pRead->setSequence(_sequence);
+// hand the read over to a SeqRead, the sequence and group are moved into it
+SeqRead* SAMRead::toSeqRead(Contig* pContig) {
+	SeqRead* pRead = new (pContig) SeqRead(_name, pContig);
+	pRead->takeSequence(_sequence);
 	pRead->setStartPosition(_startPosition + 1); // in SeqRead this will be corrected to zero-based
 	pRead->setQualitySanger(_quality);
-    pRead->setGroup(_group);
+    pRead->takeGroup(_group);
 	return pRead;
 }
 
@@ -22,28 +22,57 @@
 #define __SAMREAD_H__
 
 #include <string>
+#include <vector>
+#include <stdint.h>
 #include "SeqRead.h"
 
 using namespace std;
 
-struct operation {
-	char op;
-	int size;
+// cigar operations are packed like in BAM files: the length in the upper
+// 28 bits and the index of the operation in CIGAR_OPERATIONS in the lower 4 bits
+static const char* const CIGAR_OPERATIONS = "MIDNSHP=X";
+
+enum CigarOperation {
+	CIGAR_MATCH,
+	CIGAR_INSERTION,
+	CIGAR_DELETION,
+	CIGAR_SKIP,
+	CIGAR_SOFT_CLIP,
+	CIGAR_HARD_CLIP,
+	CIGAR_PADDING,
+	CIGAR_EQUAL,
+	CIGAR_DIFF,
+	CIGAR_OPERATION_COUNT
 };
 
+inline uint32_t packCigar(int operation, int length)	{ return (static_cast<uint32_t>(length) << 4) | operation; }
+inline int cigarOperation(uint32_t cigar)				{ return cigar & 0xF; }
+inline int cigarLength(uint32_t cigar)					{ return cigar >> 4; }
+
+// the insertion columns of a contig in front of a reference position: the
+// longest insertion of all reads at that position, and the number of
+// insertion columns in front of all earlier positions
+struct InsertionColumns {
+	int		position;
+	int		length;
+	int		cBefore;
+};
+
+inline bool operator<(const InsertionColumns& insertion, int position)	{ return insertion.position < position; }
+
 class SAMRead
 {
 public:
 	SAMRead(const string& name): _name(name)		{}
 	~SAMRead();
-	const string getName()							{ return _name; }
+	const string& getName()							{ return _name; }
 	void setSequence(const string& sequence);
 	const string& getSequence()						{ return _sequence; }
 	void setQuality(const string& quality);
 	const string& getQuality()						{ return _quality; }
 	void setContigName(const string& contigName)	{ _contigName = contigName; }
 	const string& getContigName()					{ return _contigName; }
-	list<operation>& getOperations()				{ return _ops; }
+	vector<uint32_t>& getCigar()					{ return _cigar; }
 	void setStartPosition(int startPosition)		{ _startPosition = startPosition - 1; }
     void setGroup(const string& group)              { _group = group; }
     string& getGroup()                              { return _group; }
@@ -51,13 +80,14 @@ public:
     bool hasInsertions()                            { return _bHasInsertions; }
 	char getNucleotideAt(unsigned int pos);
 	char getOperationAt(unsigned int pos);
-    bool insertGapAt(unsigned int pos);
+    void collectInsertions(vector<InsertionColumns>& insertions);
+    void padInsertions(const vector<InsertionColumns>& insertions, int cInsertionColumns);
 	bool processOperations();
 	int getLastPosition()							{ return _startPosition + _sequence.size() + 1; }
 	void setMapQuality(int mapQuality)				{ _mapQuality = mapQuality; }
 	int getMapQuality()								{ return _mapQuality; }
 	void merge(SAMRead*);
-	SeqRead* toSeqRead();
+	SeqRead* toSeqRead(Contig* pContig);
 
 private:
 	string				_name;
@@ -66,7 +96,7 @@ private:
 	string				_opsequence;
 	string				_quality;
     string              _group;
-	list<operation>		_ops;
+	vector<uint32_t>	_cigar;
 	int					_startPosition;
 	int					_mapQuality;
     bool                _bHasInsertions;
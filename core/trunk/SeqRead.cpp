@@ -37,6 +37,14 @@ SeqRead::~SeqRead(void)
 {
 }
 
+void* SeqRead::operator new(size_t size, Contig* pContig) {
+	return pContig->getArena().allocate(size);
+}
+
+// only called when the constructor throws, the memory stays in the arena
+void SeqRead::operator delete(void* /*pMemory*/, Contig* /*pContig*/) {
+}
+
 int SeqRead::getEndPosition() {
     if(_endPosition == -1) {
         _endPosition = _startPosition + _sequence.length();
@@ -46,21 +54,28 @@ int SeqRead::getEndPosition() {
 }
 
 void SeqRead::setSequence(const string& sequence) {
-	_sequence = sequence;	
+	string copy(sequence);
+	takeSequence(copy);
+}
+
+// take over the sequence without copying it, the argument is left empty
+void SeqRead::takeSequence(string& sequence) {
+	_sequence.swap(sequence);
+	string().swap(sequence);
 
 	transform (_sequence.begin (), _sequence.end (), _sequence.begin (), (int(*)(int)) toupper);
 
 	_qualClipStart = 0;
-	_qualClipEnd = sequence.length() - 1;
+	_qualClipEnd = _sequence.length() - 1;
 
 	_lowQual5p = _qualClipStart;
-	_lowQual3p = sequence.length() - 1 + _qualClipStart;
+	_lowQual3p = _sequence.length() - 1 + _qualClipStart;
 }
 
 void SeqRead::setQualitySanger(const string& quality) {
-	_quality.reserve(_sequence.length());
+	_quality.resize(quality.length());
 	for(unsigned int i = 0; i < quality.length(); i++) {
-		_quality.push_back(quality[i] - 33);
+		_quality[i] = quality[i] - 33;
 	}
 }
 
@@ -100,6 +115,13 @@ void SeqRead::setQualClip(unsigned int qualClipStart, unsigned int qualClipEnd)
 
 
 bool SeqRead::isHighQuality(int pos) {
+	int minQualityScore = (_parent != NULL) ? _parent->getParameters().minSNPQualityScore : Configuration::getConfig()->getInt("minSNPQualityScore");
+	return isHighQuality(pos, minQualityScore);
+}
+
+// high quality if pos is outside the low quality ends and the quality score
+// is at least minQualityScore
+bool SeqRead::isHighQuality(int pos, int minQualityScore) {
 	if(pos < _startPosition) {
         return false;
     }
@@ -110,7 +132,7 @@ bool SeqRead::isHighQuality(int pos) {
 	}
 
 	if (pos < _quality.size()) {
-		return (_quality[pos] >= Configuration::getConfig()->getInt("minSNPQualityScore"));
+		return (_quality[pos] >= minQualityScore);
 	}
 
 	// if there is no quality information available for this position, consider it high quality
@@ -121,11 +143,20 @@ bool SeqRead::isHighQuality(int pos) {
 // _lowQual5p is the position the low quality region 5' ends, 
 // _lowQual3p is the postion the low quality region 3' begins
 void SeqRead::setLowQualityBounds() {
-	_lowQual5p = Configuration::getConfig()->getInt("lowQualityRegion5prime") + _qualClipStart;
-	int lowQual3p = Configuration::getConfig()->getInt("lowQualityRegion3prime");
+	if(_parent == NULL) {
+		// not part of a contig, use the configuration
+		setLowQualityBounds(RunParameters(Configuration::getConfig()));
+	} else {
+		setLowQualityBounds(_parent->getParameters());
+	}
+}
+
+void SeqRead::setLowQualityBounds(const RunParameters& parameters) {
+	_lowQual5p = parameters.lowQualityRegion5prime + _qualClipStart;
+	int lowQual3p = parameters.lowQualityRegion3prime;
 
 	if (lowQual3p == 0) {
-		double lqPerc = Configuration::getConfig()->getDouble("lowQualityRegion3primePerc");
+		double lqPerc = parameters.lowQualityRegion3primePerc;
 		_lowQual3p = int((1.0 - lqPerc) * getClippedSequenceLength()) + _qualClipStart;
 	} else {
 		_lowQual3p = getClippedSequenceLength() - lowQual3p - 1  + _qualClipStart;
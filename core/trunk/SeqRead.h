@@ -27,6 +27,7 @@
 
 class Contig;
 class HaploType;
+struct RunParameters;
 
 using namespace std;
 
@@ -35,8 +36,14 @@ class SeqRead
 public:
 	SeqRead(string, Contig* = NULL);
 	~SeqRead(void);
+	// allocated in the arena of the contig: new (pContig) SeqRead(...)
+	static void* operator new(size_t size, Contig* pContig);
+	static void operator delete(void* pMemory, Contig* pContig);
+
 	void setSequence(const string&);
+	void takeSequence(string&);
     void setGroup(const string& group)      { _group = group; }
+    void takeGroup(string& group)           { _group.swap(group); }
     const string& getName()         { return _name; }
     const string& getSequence()     { return _sequence; }
     const string& getGroup()         { return _group; }
@@ -57,6 +64,9 @@ public:
     const string toString();
 	char getNucleotideAt(int pos);
 	bool isHighQuality(int pos);
+	bool isHighQuality(int pos, int minQualityScore);
+	int getHighQualityStart()		{ return _lowQual5p; }
+	int getHighQualityEnd()			{ return _lowQual3p; }
 	bool calculateSNPCount();
 
     void setHaploType(HaploType* pHaploType) {_pHaploType = pHaploType; }
@@ -68,6 +78,7 @@ public:
 
 private:
 	void			setLowQualityBounds();
+	void			setLowQualityBounds(const RunParameters& parameters);
 
 	Contig*			_parent;
 	const string	_name;
@@ -84,7 +95,7 @@ private:
 	int				_cSNP;
 	int				_cHQSNP;
 	HaploType*		_pHaploType;
-	vector<int>		_quality;
+	vector<unsigned char>	_quality;	// Phred scores
 };
 
 #endif
@@ -19,6 +19,7 @@
 */
 
 #include <iostream>
+#include <algorithm>
 #include "Configuration.h"
 #include "HaploType.h"
 #include "SeqRead.h"
@@ -30,32 +31,30 @@ Variation::Variation(Contig* pContig, int pos) :
          _flankLength(0), _bDefining(false), _bHighConfidence(false), _bReliable(false), _cHaplotypes(-1),
         _nucCount(NULL), _HQNucCount(NULL), _LQNucCount(NULL)
 {
-	int nDifferentNucs = Configuration::getConfig()->getNumberOfNucs();
-	_HQNucCount = new int[nDifferentNucs];
-	_LQNucCount = new int[nDifferentNucs];
+	int nDifferentNucs = _pContig->getParameters().cNucs;
+	_HQNucCount = _pContig->getArena().allocateArray<int>(nDifferentNucs);
+	_LQNucCount = _pContig->getArena().allocateArray<int>(nDifferentNucs);
 
 	calculateHighLowQuality();
 } 
+// the count arrays are in the arena of the contig
 Variation::~Variation(void)
 {
-	// clean up the reserve arrays
-    if(_nucCount != NULL) {
-        delete [] _nucCount;
-    }
-
-    if(_HQNucCount != NULL) {
-        delete [] _HQNucCount;
-    }
+}
 
-    if(_LQNucCount != NULL) {
-        delete [] _LQNucCount;
-    }
+void* Variation::operator new(size_t size, Contig* pContig) {
+	return pContig->getArena().allocate(size);
 }
 
-bool Variation::setNucCount(int* nucCount) {
-	_nucCount = nucCount;
+// only called when the constructor throws, the memory stays in the arena
+void Variation::operator delete(void* /*pMemory*/, Contig* /*pContig*/) {
+}
 
-	int nDifferentNucs = Configuration::getConfig()->getNumberOfNucs();
+// copy the nucleotide counts at the position of this variation
+bool Variation::setNucCount(const int* nucCount) {
+	int nDifferentNucs = _pContig->getParameters().cNucs;
+	_nucCount = _pContig->getArena().allocateArray<int>(nDifferentNucs);
+	copy(nucCount, nucCount + nDifferentNucs, _nucCount);
 
 	for(int iNuc = 1; iNuc < nDifferentNucs; iNuc++) {
 		if(_nucCount[iNuc] > 0) { 
@@ -110,20 +109,20 @@ int Variation::getHaplotypeCount() {
 // return the confidence score for this variation
 int Variation::getConfidenceScore() {
     if(_confidenceScore == -1) {
-		Configuration* pConfig = Configuration::getConfig();
+		const RunParameters& parameters = _pContig->getParameters();
 		// when the position in the contig is already low quality, then so is this SNP
-		if(_pContig->getQualityAt(_pos) < pConfig->getInt("minSNPQualityScore")) {
+		if(_pContig->getQualityAt(_pos) < parameters.minSNPQualityScore) {
             _confidenceScore = 1;
-		} else if (pConfig->getBool("indelLowQuality") && 
-			(pConfig->int2nuc(_majorAllele) == '*' || pConfig->int2nuc(_minorAllele) == '*')) {
+		} else if (parameters.indelLowQuality && 
+			(parameters.int2nuc(_majorAllele) == '*' || parameters.int2nuc(_minorAllele) == '*')) {
             _confidenceScore = 1;
-        } else if (pConfig->getBool("lowComplexityLowQuality") && (insideHomopolymetricTract())) {
+        } else if (parameters.lowComplexityLowQuality && (insideHomopolymetricTract())) {
             _confidenceScore = 1;
 		} else {
             _confidenceScore = min(calculateScore(_majorAllele),calculateScore(_minorAllele));
 		}
 
-        _bHighConfidence = _confidenceScore >= pConfig->getInt("minimalConfidenceScore");
+        _bHighConfidence = _confidenceScore >= parameters.minimalConfidenceScore;
 	}
 
     return _confidenceScore;
@@ -131,12 +130,12 @@ int Variation::getConfidenceScore() {
 
 bool Variation::insideHomopolymetricTract()
 {
-    Configuration* pConfig = Configuration::getConfig();
-    int fragmentSize = pConfig->getInt("lowComplexityRegionSize");
-    int repeatCount = pConfig->getInt("lowComplexityRepeatCount");
+    const RunParameters& parameters = _pContig->getParameters();
+    int fragmentSize = parameters.lowComplexityRegionSize;
+    int repeatCount = parameters.lowComplexityRepeatCount;
 
-    char majorAllele = pConfig->int2nuc(_majorAllele);
-    char minorAllele = pConfig->int2nuc(_minorAllele);
+    char majorAllele = parameters.int2nuc(_majorAllele);
+    char minorAllele = parameters.int2nuc(_minorAllele);
 
     string sequenceRegion(1,_pContig->getSequenceAt(_pos));
 
@@ -180,28 +179,12 @@ bool Variation::insideHomopolymetricTract()
 }
 
 
-// calculate the number of high and low quality nucleotides
+// calculate the number of high and low quality nucleotides, the counts
+// come from the pileup of the contig
 void Variation::calculateHighLowQuality() {
     _confidenceScore = -1;
 
-	Configuration* pConfig = Configuration::getConfig();
-	int nDifferentNucs = pConfig->getNumberOfNucs();
-
-	for(int iNuc= 0; iNuc < nDifferentNucs; iNuc++) {
-		_HQNucCount[iNuc] = 0;
-		_LQNucCount[iNuc] = 0;
-	}
-
-	const list<SeqRead*>& reads = _pContig->getReads();
-	list<SeqRead*>::const_iterator itReads;
-
-    for ( itReads= reads.begin(); itReads != reads.end(); itReads++) {
-        char nuc = (*itReads)->getNucleotideAt(_pos);
-        int nNuc = pConfig->nuc2int(nuc);
-        if (nNuc != -1) {
-            (*itReads)->isHighQuality(_pos) ? _HQNucCount[nNuc]++ : _LQNucCount[nNuc]++;
-        }
-    }
+	_pContig->getQualityCounts(_pos, _HQNucCount, _LQNucCount);
 }
 
 // a variation is high confidence if the quality score is at least equal to the minimal confidence score
@@ -226,12 +209,13 @@ void Variation::determineReliable() {
 	const list<HaploType*>& haploTypes = _pContig->getHaploTypes();
 	list<HaploType*>::const_iterator itHaploTypes; 
 
-	Configuration* pConfig = Configuration::getConfig();
-	int nDifferentNucs = pConfig->getNumberOfNucs(); // for readability
+	const RunParameters& parameters = _pContig->getParameters();
+	int nDifferentNucs = parameters.cNucs; // for readability
+	int minQualityScore = parameters.minSNPQualityScore;
 
-	double wh = pConfig->getDouble("weightHighQualityRegion");
-	double wl = pConfig->getDouble("weightLowQualityRegion");
-	double alleleMajorityThreshold = pConfig->getDouble("alleleMajorityThreshold");
+	double wh = parameters.weightHighQualityRegion;
+	double wl = parameters.weightLowQualityRegion;
+	double alleleMajorityThreshold = parameters.alleleMajorityThreshold;
 
 	HaploType ** nucHaploType = new HaploType*[nDifferentNucs];
 	int* nucCount = new int[nDifferentNucs]; // keep a count of all nucleotides
@@ -256,13 +240,13 @@ void Variation::determineReliable() {
 
 		for (itReads=reads.begin(); itReads != reads.end(); itReads++) {
 			char nuc = (*itReads)->getNucleotideAt(_pos);
-			int nNuc = pConfig->nuc2int(nuc);
+			int nNuc = parameters.nuc2int(nuc);
 			if (nNuc != -1) {
 				cInformativeReads++;
 				if(nNuc == _majorAllele) {
-					((*itReads)->isHighQuality(_pos)) ? cMajorAlleleHQ++ : cMajorAlleleLQ++;
+					((*itReads)->isHighQuality(_pos, minQualityScore)) ? cMajorAlleleHQ++ : cMajorAlleleLQ++;
 				} else if (nNuc == _minorAllele) {
-					((*itReads)->isHighQuality(_pos)) ? cMinorAlleleHQ++ : cMinorAlleleLQ++;
+					((*itReads)->isHighQuality(_pos, minQualityScore)) ? cMinorAlleleHQ++ : cMinorAlleleLQ++;
 				}
 
 				// check if this is the first time we encounter this nucleotide
@@ -313,8 +297,8 @@ const string Variation::toCSV() {
 	stringstream csv;
 	csv << _pContig->getName() << sep;
 	csv << _pos << sep;
-	csv << pConfig->int2nuc(_majorAllele) << sep;
-	csv << pConfig->int2nuc(_minorAllele) << sep;
+	csv << _pContig->getParameters().int2nuc(_majorAllele) << sep;
+	csv << _pContig->getParameters().int2nuc(_minorAllele) << sep;
 	csv << isHighConfidence() << sep;
 	csv << isReliable() << sep;
 	csv << isDefining() << sep;
@@ -335,20 +319,20 @@ int Variation::getIUPAC() {
 
 void Variation::setMajorAllele(char nucl)
 {
-    _majorAllele = Configuration::getConfig()->nuc2int(nucl);
+    _majorAllele = _pContig->getParameters().nuc2int(nucl);
 }
 
 void Variation::setMinorAllele(char nucl)
 {
-    _minorAllele = Configuration::getConfig()->nuc2int(nucl);
+    _minorAllele = _pContig->getParameters().nuc2int(nucl);
 }
 
 char Variation::getMajorAllele()
 {
-    return Configuration::getConfig()->int2nuc(_majorAllele);
+    return _pContig->getParameters().int2nuc(_majorAllele);
 }
 
 char Variation::getMinorAllele()
 {
-    return Configuration::getConfig()->int2nuc(_minorAllele);
+    return _pContig->getParameters().int2nuc(_minorAllele);
 }
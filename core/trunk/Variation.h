@@ -30,9 +30,13 @@ class Variation
 public:
 	Variation(Contig*, int);
 	~Variation(void);
+	// allocated in the arena of the contig: new (pContig) Variation(...)
+	static void* operator new(size_t size, Contig* pContig);
+	static void operator delete(void* pMemory, Contig* pContig);
+
     int getConfidenceScore();
 	void setQualityNucCount(int*, int*);
-	bool setNucCount(int*);
+	bool setNucCount(const int*);
 	int getAlleleCount() { return _cAlleles; }
 	int getHaplotypeCount();
 	unsigned int getPos() { return _pos; }
@@ -44,20 +44,28 @@ ReadGroupModel::ReadGroupModel(Contig* pContig, QObject *parent) :
         }
     }
 
+    // the nucleotide counts per group at every variation, only the reads
+    // that cover the position are looked at
+    vector<map<string, map<char, int> > > groupNucCounts(variations.size());
+    for(size_t iVar = 0; iVar < variations.size(); iVar++) {
+        int pos = variations[iVar]->getPos();
+        vector<SeqRead*> coveringReads = pContig->readsOverlapping(pos);
+        for(vector<SeqRead*>::iterator itRead = coveringReads.begin(); itRead != coveringReads.end(); itRead++) {
+            const string& group = (*itRead)->getGroup();
+            if(!group.empty()) {
+                groupNucCounts[iVar][group][(*itRead)->getNucleotideAt(pos)]++;
+            }
+        }
+    }
+
     for(map<string, list<SeqRead*> >::iterator itGroup = groupMap.begin(); itGroup != groupMap.end(); itGroup++) {
         QStringList nucleotideList;
         QStringList detailList;
         QString groupID = QString::fromStdString((*itGroup).first);
 
         int cReads = (*itGroup).second.size();
-        for(vector<Variation*>::iterator itVar = variations.begin(); itVar != variations.end(); itVar++) {
-            int pos = (*itVar)->getPos();
-
-            map<char, int> nucCount;
-            for(list<SeqRead*>::iterator itRead = (*itGroup).second.begin(); itRead != (*itGroup).second.end(); itRead++) {
-                char nuc = (*itRead)->getNucleotideAt(pos);
-                nucCount[nuc]++;
-            }
+        for(size_t iVar = 0; iVar < variations.size(); iVar++) {
+            map<char, int>& nucCount = groupNucCounts[iVar][(*itGroup).first];
             int cMajorAllele = 0;
             int cMinorAllele = 0;
             char majorAllele = ' ';